@@ -0,0 +1,227 @@
+#include "bench.h"
+#include "../memory/allocation_counter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+BenchOptions parse_bench_options(int argc, char **argv)
+{
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--bench") == 0) {
+            options.enabled = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmup = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--timestep") == 0 && hasValue) {
+            options.timestep = std::strtof(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            options.output = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+            options.trace = argv[++i];
+        } else if (std::strcmp(argv[i], "--counters") == 0 && hasValue) {
+            options.counters = argv[++i];
+        } else if (std::strcmp(argv[i], "--deferred") == 0) {
+            options.deferred = true;
+        } else if (std::strcmp(argv[i], "--no-shadows") == 0) {
+            options.shadows = false;
+        } else if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+            options.depthPrepass = true;
+        } else if (std::strcmp(argv[i], "--front-to-back") == 0) {
+            options.frontToBack = true;
+        } else if (std::strcmp(argv[i], "--no-lod") == 0) {
+            options.lod = false;
+        } else {
+            fprintf(stderr, "Ignoring unknown argument %s.\n", argv[i]);
+        }
+    }
+
+    return options;
+}
+
+void apply_bench_camera(Camera &camera, float time)
+{
+    float angle = time * 0.3f;
+    float radius = 8.0f + std::sin(time * 0.7f) * 3.0f;
+    glm::vec3 position(std::cos(angle) * radius, 1.5f + std::sin(time * 0.5f) * 0.5f, std::sin(angle) * radius);
+
+    // Look back at the middle of the sea floor.
+    float yaw = glm::degrees(std::atan2(-position.z, -position.x));
+    camera.set_pose(position, yaw, -10.0f);
+}
+
+BenchRecorder::BenchRecorder(const BenchOptions &options)
+{
+    OPTIONS = options;
+    CPU_TIMES.reserve(options.frames);
+    GPU_TIMES.reserve(options.frames);
+
+    glGenQueries(BENCH_GPU_QUERIES, QUERIES);
+}
+
+BenchRecorder::~BenchRecorder()
+{
+    glDeleteQueries(BENCH_GPU_QUERIES, QUERIES);
+}
+
+bool BenchRecorder::running() const
+{
+    return FRAME < OPTIONS.warmup + OPTIONS.frames;
+}
+
+bool BenchRecorder::measuring() const
+{
+    return FRAME >= OPTIONS.warmup;
+}
+
+float BenchRecorder::get_time() const
+{
+    return (float)FRAME * OPTIONS.timestep;
+}
+
+void BenchRecorder::collect_query(unsigned int slot, bool wait)
+{
+    if (!QUERY_PENDING[slot]) {
+        return;
+    }
+
+    if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(QUERIES[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+    }
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(QUERIES[slot], GL_QUERY_RESULT, &elapsed);
+    QUERY_PENDING[slot] = false;
+
+    if (QUERY_FRAMES[slot] >= OPTIONS.warmup) {
+        GPU_TIMES.push_back((double)elapsed / 1e6);
+    }
+}
+
+void BenchRecorder::begin_frame()
+{
+    unsigned int slot = FRAME % BENCH_GPU_QUERIES;
+
+    // The query is reused every BENCH_GPU_QUERIES frames, by then its result is normally ready.
+    collect_query(slot, true);
+
+    glBeginQuery(GL_TIME_ELAPSED, QUERIES[slot]);
+    QUERY_FRAMES[slot] = FRAME;
+    QUERY_PENDING[slot] = true;
+
+    FRAME_START = std::chrono::steady_clock::now();
+    FRAME_ALLOCATIONS = AllocationCounter::get_count();
+}
+
+void BenchRecorder::end_frame(uint64_t drawCalls, uint64_t triangles)
+{
+    size_t allocations = AllocationCounter::get_count() - FRAME_ALLOCATIONS;
+    glEndQuery(GL_TIME_ELAPSED);
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FRAME_START).count();
+
+    if (FRAME >= OPTIONS.warmup) {
+        CPU_TIMES.push_back(elapsed);
+        DRAW_CALLS += drawCalls;
+        TRIANGLES += triangles;
+        ALLOCATIONS += allocations;
+        ALLOCATING_FRAMES += allocations ? 1 : 0;
+    }
+
+    for (unsigned int slot = 0; slot < BENCH_GPU_QUERIES; slot++) {
+        if (slot != FRAME % BENCH_GPU_QUERIES) {
+            collect_query(slot, false);
+        }
+    }
+
+    FRAME++;
+}
+
+unsigned int BenchRecorder::get_allocating_frames() const
+{
+    return ALLOCATING_FRAMES;
+}
+
+size_t BenchRecorder::get_allocations() const
+{
+    return ALLOCATIONS;
+}
+
+static void write_statistics(FILE *file, const char *name, vector<double> samples, bool last)
+{
+    fprintf(file, "  \"%s\": {", name);
+
+    if (samples.empty()) {
+        fprintf(file, "\"samples\": 0}%s\n", last ? "" : ",");
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+
+    // Nearest-rank percentile.
+    auto percentile = [&samples](double p) {
+        size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+        return samples[std::min(samples.size() - 1, rank ? rank - 1 : 0)];
+    };
+
+    fprintf(file, "\"samples\": %zu, \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+            samples.size(), samples.front(), sum / samples.size(),
+            percentile(50), percentile(95), percentile(99), samples.back(), last ? "" : ",");
+}
+
+bool BenchRecorder::write_report()
+{
+    for (unsigned int slot = 0; slot < BENCH_GPU_QUERIES; slot++) {
+        collect_query(slot, true);
+    }
+
+    FILE *file = OPTIONS.output == "-" ? stdout : fopen(OPTIONS.output.c_str(), "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s for the benchmark report.\n", OPTIONS.output.c_str());
+        return false;
+    }
+
+    size_t frames = CPU_TIMES.size();
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"renderer\": \"%s\",\n", renderer ? renderer : "unknown");
+    fprintf(file, "  \"shading\": \"%s\",\n", OPTIONS.deferred ? "deferred" : "forward");
+    fprintf(file, "  \"shadows\": %s,\n", OPTIONS.shadows ? "true" : "false");
+    fprintf(file, "  \"depth_prepass\": %s,\n", OPTIONS.depthPrepass ? "true" : "false");
+    fprintf(file, "  \"sort\": \"%s\",\n", OPTIONS.frontToBack ? "front_to_back" : "state");
+    fprintf(file, "  \"lod\": %s,\n", OPTIONS.lod ? "true" : "false");
+    fprintf(file, "  \"frames\": %zu,\n", frames);
+    fprintf(file, "  \"warmup_frames\": %u,\n", OPTIONS.warmup);
+    fprintf(file, "  \"timestep\": %.6f,\n", OPTIONS.timestep);
+    fprintf(file, "  \"draw_calls_per_frame\": %.2f,\n", frames ? (double)DRAW_CALLS / frames : 0.0);
+    fprintf(file, "  \"triangles_per_frame\": %.2f,\n", frames ? (double)TRIANGLES / frames : 0.0);
+    if (AllocationCounter::enabled()) {
+        fprintf(file, "  \"allocating_frames\": %u,\n", ALLOCATING_FRAMES);
+        fprintf(file, "  \"heap_allocations\": %zu,\n", ALLOCATIONS);
+    }
+    write_statistics(file, "cpu_frame_ms", CPU_TIMES, false);
+    write_statistics(file, "gpu_frame_ms", GPU_TIMES, true);
+    fprintf(file, "}\n");
+
+    if (file != stdout) {
+        fclose(file);
+    }
+
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "../camera/camera.h"
+
+using std::string;
+using std::vector;
+
+#define BENCH_GPU_QUERIES 4
+
+struct BenchOptions {
+    bool         enabled = false;
+    unsigned int frames = 1000;
+    unsigned int warmup = 60;
+    float        timestep = 1.0f / 60.0f;
+    string       output = "-";
+    string       trace;
+    string       counters = "counters.csv";
+    bool         deferred = false;
+    bool         shadows = true;
+    bool         depthPrepass = false;
+    bool         frontToBack = false;
+    bool         lod = true;
+};
+
+// Recognises --bench, --frames N, --warmup N, --timestep S, --output PATH ("-" is stdout)
+// --trace PATH, which writes a profiler capture of the measured frames, and --counters PATH
+// for the per frame counter history ("" disables it). --deferred renders through the G-buffer path,
+// --no-shadows skips the shadow map passes, --depth-prepass lays down forward depth before
+// shading with GL_EQUAL, --front-to-back sorts the opaque draws by depth before state and
+// --no-lod draws every mesh at full resolution.
+BenchOptions parse_bench_options(int argc, char **argv);
+
+// Deterministic orbit over the sea floor, a pure function of the simulated time.
+void apply_bench_camera(Camera &camera, float time);
+
+class BenchRecorder
+{
+    private:
+        BenchOptions OPTIONS;
+        unsigned int FRAME = 0;
+
+        std::chrono::steady_clock::time_point FRAME_START;
+        vector<double> CPU_TIMES, GPU_TIMES;
+        unsigned long long DRAW_CALLS = 0, TRIANGLES = 0;
+        size_t       FRAME_ALLOCATIONS = 0, ALLOCATIONS = 0;
+        unsigned int ALLOCATING_FRAMES = 0;
+
+        GLuint       QUERIES[BENCH_GPU_QUERIES] {};
+        unsigned int QUERY_FRAMES[BENCH_GPU_QUERIES] {};
+        bool         QUERY_PENDING[BENCH_GPU_QUERIES] {};
+
+        void collect_query(unsigned int slot, bool wait);
+
+    public:
+        explicit BenchRecorder(const BenchOptions &options);
+        BenchRecorder(const BenchRecorder&) = delete;
+        BenchRecorder& operator=(const BenchRecorder&) = delete;
+        ~BenchRecorder();
+
+        bool running() const;
+        bool measuring() const;
+        float get_time() const;
+
+        void begin_frame();
+        // Totals over every pass of the frame, the Counters of the frame just ended.
+        void end_frame(uint64_t drawCalls, uint64_t triangles);
+
+        // Heap allocations during measured frames, always zero without FPS_COUNT_ALLOCATIONS.
+        unsigned int get_allocating_frames() const;
+        size_t get_allocations() const;
+
+        // Waits for outstanding GPU timings and writes the JSON report, returns false on I/O failure.
+        bool write_report();
+};
+
+#endif
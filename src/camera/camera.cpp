@@ -55,6 +55,13 @@ void Camera::handle_mouse(double x, double y)
     }
 }
 
+void Camera::set_pose(glm::vec3 position, float yaw, float pitch)
+{
+    POSITION = position;
+    YAW = yaw;
+    PITCH = pitch;
+}
+
 float Camera::get_fov() const
 {
     return FOV;
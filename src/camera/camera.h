@@ -29,6 +29,7 @@ class Camera {
         Camera(glm::vec3 position, glm::vec3 front, glm::vec3 up);
         void handle_key(int action, float deltaTime);
         void handle_mouse(double x, double y);
+        void set_pose(glm::vec3 position, float yaw, float pitch);
         float get_fov() const;
         glm::mat4 get_view_matrix();
         glm::vec3 get_position();
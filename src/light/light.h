@@ -4,6 +4,9 @@
 #include <glm/glm.hpp>
 #include "light_type.h"
 
+// Contributions below one step of an 8-bit channel are not visible.
+#define LIGHT_CUTOFF (1.0f / 256.0f)
+
 class Light {
     protected:
         LightType TYPE;
@@ -11,6 +14,7 @@ class Light {
 
     public:
         Light(LightType type, glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular);
+        virtual ~Light() = default;
         LightType get_type();
         glm::vec3 get_ambient();
         glm::vec3 get_diffuse();
@@ -21,6 +25,8 @@ class Light {
         virtual float get_constant() {return {};};
         virtual float get_linear() {return {};};
         virtual float get_quadratic() {return {};};
+        // Distance past which the light contributes less than LIGHT_CUTOFF, 0 for lights without falloff.
+        virtual float get_range() {return {};};
 };
 
 #endif
@@ -1,4 +1,7 @@
 #include "point_light.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 PointLight::PointLight(
     glm::vec3 position,
@@ -13,6 +16,19 @@ PointLight::PointLight(
     CONSTANT = constant;
     LINEAR = linear;
     QUADRATIC = quadratic;
+
+    // Solve constant + linear * d + quadratic * d^2 = brightest channel / cutoff for d.
+    float brightest = std::max({ambient.r, ambient.g, ambient.b, diffuse.r, diffuse.g, diffuse.b, specular.r, specular.g, specular.b});
+    float falloff = brightest / LIGHT_CUTOFF - constant;
+    if (falloff <= 0.0f) {
+        RANGE = 0.0f;
+    } else if (quadratic > 0.0f) {
+        RANGE = (-linear + std::sqrt(linear * linear + 4.0f * quadratic * falloff)) / (2.0f * quadratic);
+    } else if (linear > 0.0f) {
+        RANGE = falloff / linear;
+    } else {
+        RANGE = FLT_MAX;
+    }
 }
 
 glm::vec3 PointLight::get_position() {
@@ -30,3 +46,7 @@ float PointLight::get_linear() {
 float PointLight::get_quadratic() {
     return QUADRATIC;
 }
+
+float PointLight::get_range() {
+    return RANGE;
+}
@@ -8,7 +8,7 @@
 class PointLight : public Light {
     protected:
         glm::vec3 POSITION{};
-        float CONSTANT, LINEAR, QUADRATIC;
+        float CONSTANT, LINEAR, QUADRATIC, RANGE;
 
     public:
         PointLight(
@@ -24,6 +24,7 @@ class PointLight : public Light {
         float get_constant() override;
         float get_linear() override;
         float get_quadratic() override;
+        float get_range() override;
 };
 
 #endif
@@ -9,8 +9,20 @@
 #include <random>
 
 #include "shader/shader.h"
+#include "shader/program_cache.h"
 #include "camera/camera.h"
 #include "model/model.h"
+#include "scene/scene.h"
+#include "render/frustum.h"
+#include "render/culling_batch.h"
+#include "render/render_queue.h"
+#include "render/deferred_renderer.h"
+#include "render/lod.h"
+#include "memory/allocation_counter.h"
+#include "memory/frame_arena.h"
+#include "bench/bench.h"
+#include "profile/profiler.h"
+#include "profile/counters.h"
 #include "light/light.h"
 #include "light/directional_light.h"
 #include "light/point_light.h"
@@ -21,20 +33,16 @@ using std::map;
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod);
 void mouse_callback(GLFWwindow* window, double x, double y);
-void draw_scene(
-    Shader shader,
-    Shader lampShader,
-    Shader wavyShader,
-    Model fish,
-    Model fish2,
-    Model fish3,
-    Model seaweed,
-    Model sand,
-    Model cube,
-    const vector<Light*>& lights
-);
-vector<Light *> generate_lights();
+void prepare_shader_variants(Scene &scene, const struct SceneHandles &handles);
+void draw_scene(Scene &scene, const struct SceneHandles &handles, float time, FrameArena &arena, DeferredRenderer *deferred);
+void draw_shadow_maps(Scene &scene, const struct SceneHandles &handles, const ModelHandle *fish, const glm::mat4 *fishTransforms,
+                      const Bounds *fishBounds, const unsigned int *fishLods, int fishCount, FrameArena &arena, int width, int height);
+int run_benchmark(GLFWwindow *window, Scene &scene, const struct SceneHandles &handles, const BenchOptions &options);
+void generate_lights(Scene &scene);
 void generate_seaweed();
+vector<glm::mat4> seaweed_transforms();
+void prepare_seaweed_culling(const Bounds &bounds);
+void prepare_shadow_bounds(Scene &scene, const struct SceneHandles &handles);
 void remove_vector_value(int value, vector<int> &vec);
 void handle_keys();
 
@@ -61,14 +69,53 @@ map<int, int> key_mappings {
 };
 vector<int> pressed_keys {};
 
+#define SEAWEED_COUNT 200
+#define OBJECT_COUNT 4
+#define GLOW_LIGHT_COUNT 256
+#define SEAWEED_WAVE_AMPLITUDE 0.1f
+#define ALLOCATION_WARMUP_FRAMES 3
+#define TRACE_PATH "trace.json"
+#define COUNTERS_PATH "counters.csv"
+
+struct SceneHandles {
+    ShaderHandle shader, lampShader, wavyShader, depthShader, depthInstancedShader, depthWavyShader;
+    ShaderHandle gbufferShader, gbufferWavyShader, deferredDirectionalShader, deferredPointShader;
+    ModelHandle fish, fish2, fish3, seaweed, sand, cube;
+};
+
+
 struct Seaweed {
     glm::vec2 coords;
     float scale;
     float rotation;
 };
 vector<Seaweed> seaweed_data {};
-
-GLFWwindow* initialize_program() {
+vector<glm::mat4> seaweed_instances {};
+// Point lights drawn with a lamp cube, owned by the scene.
+vector<Light *> lamps {};
+// The directional light casting shadows, owned by the scene.
+Light *sun = nullptr;
+const glm::mat4 sand_transform = glm::scale(glm::mat4(1.0f), glm::vec3(10.0f, 1.0f, 10.0f));
+// Sand and seaweed, the casters of the cached shadow map.
+Bounds shadow_bounds {};
+CullingBatch seaweed_culling {}, object_culling {};
+// Detail level every object and seaweed instance was last drawn at, for the hysteresis.
+unsigned int object_lods[OBJECT_COUNT] {};
+vector<unsigned int> seaweed_lods {};
+
+RenderQueue render_queue {};
+// Draws after deferred lighting, on top of the lit G-buffer.
+RenderQueue overlay_queue {};
+RenderQueue shadow_queue {};
+// Depth only copy of the forward draws, laid down before shading when depth_prepass is on.
+RenderQueue depth_queue {};
+bool deferred_shading = false;
+bool shadows_enabled = true;
+bool depth_prepass = false;
+bool lod_enabled = true;
+FrameArena frame_arena {};
+
+GLFWwindow* initialize_program(bool headless) {
     glfwInit();
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -79,6 +126,11 @@ GLFWwindow* initialize_program() {
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     #endif
 
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+
     GLFWwindow* window = glfwCreateWindow(800, 600, "fps", nullptr, nullptr);
     if (!window) {
         fprintf(stderr, "Failed to initialize window.");
@@ -91,6 +143,7 @@ GLFWwindow* initialize_program() {
         fprintf(stderr, "Failed to initialize GLAD.");
         exit(EXIT_FAILURE);
     }
+    ProgramCache::init();
 
     int width, height;
     glfwGetFramebufferSize(window, &width, &height);
@@ -104,122 +157,236 @@ GLFWwindow* initialize_program() {
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
 
+    if (headless) {
+        glfwSwapInterval(0);
+    }
+
     return window;
 }
 
-int main() {
-    GLFWwindow* window = initialize_program();
-
-    Shader shader("../src/shader/model_vertex.glsl", "../src/shader/model_fragment.glsl");
-    Shader lampShader("../src/shader/lamp_v.glsl", "../src/shader/lamp_f.glsl");
-    Shader wavyShader("../src/shader/wavy_vertex.glsl", "../src/shader/model_fragment.glsl");
-    Shader depthShader("../src/shader/depth_vertex.glsl", "../src/shader/null.glsl");
-
-    Model fish("../models/fish/ryba.obj");
-    Model fish2("../models/fish2/ryba.obj");
-    Model fish3("../models/fish3/ryba.obj");
-    Model seaweed("../models/seaweed/glon.obj");
-    Model sand("../models/sand/sand.obj");
-    Model cube("../models/cube/cube.obj");
-    vector<Light*> lights = generate_lights();
+int main(int argc, char **argv) {
+    BenchOptions bench = parse_bench_options(argc, argv);
+    GLFWwindow* window = initialize_program(bench.enabled);
+
+    Scene scene;
+    SceneHandles handles {};
+
+    handles.shader = scene.add_shader("../src/shader/model_vertex.glsl", "../src/shader/model_fragment.glsl");
+    handles.lampShader = scene.add_shader("../src/shader/lamp_v.glsl", "../src/shader/lamp_f.glsl");
+    handles.wavyShader = scene.add_shader("../src/shader/wavy_instanced_vertex.glsl", "../src/shader/model_fragment.glsl");
+    handles.depthShader = scene.add_shader("../src/shader/depth_vertex.glsl", "../src/shader/null.glsl");
+    handles.depthInstancedShader = scene.add_shader("../src/shader/depth_instanced_vertex.glsl", "../src/shader/null.glsl");
+    handles.depthWavyShader = scene.add_shader("../src/shader/depth_wavy_instanced_vertex.glsl", "../src/shader/null.glsl");
+    handles.gbufferShader = scene.add_shader("../src/shader/model_vertex.glsl", "../src/shader/gbuffer_fragment.glsl");
+    handles.gbufferWavyShader = scene.add_shader("../src/shader/wavy_instanced_vertex.glsl", "../src/shader/gbuffer_fragment.glsl");
+    handles.deferredDirectionalShader = scene.add_shader("../src/shader/deferred_fullscreen_v.glsl", "../src/shader/deferred_directional_f.glsl");
+    handles.deferredPointShader = scene.add_shader("../src/shader/deferred_point_v.glsl", "../src/shader/deferred_point_f.glsl");
+
+    handles.fish = scene.add_model("../models/fish/ryba.obj");
+    handles.fish2 = scene.add_model("../models/fish2/ryba.obj");
+    handles.fish3 = scene.add_model("../models/fish3/ryba.obj");
+    handles.seaweed = scene.add_model("../models/seaweed/glon.obj", VertexFormat::COMPACT);
+    handles.sand = scene.add_model("../models/sand/sand.obj");
+    handles.cube = scene.add_model("../models/cube/cube.obj");
+    scene.finish_loading();
+    scene.get_assets().print_report();
+    generate_lights(scene);
+    prepare_shader_variants(scene, handles);
+    ProgramCache::print_report();
     generate_seaweed();
+    seaweed_instances = seaweed_transforms();
+    seaweed_lods.assign(seaweed_instances.size(), 0);
+    prepare_seaweed_culling(scene.get_model(handles.seaweed).get_bounds());
+    prepare_shadow_bounds(scene, handles);
 
+    if (bench.enabled) {
+        int status = run_benchmark(window, scene, handles, bench);
+        glfwTerminate();
+        exit(status);
+    }
+
+    DeferredRenderer deferred;
+
+    unsigned long frame = 0;
     while(!glfwWindowShouldClose(window)) {
+        frame_arena.reset();
+        Profiler::get().begin_frame();
+        size_t allocations = AllocationCounter::get_count();
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         float currentFrame = (float)glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        handle_keys();
-        draw_scene(shader, lampShader, wavyShader, fish, fish2, fish3, seaweed, sand, cube, lights);
+        {
+            PROFILE_ZONE("input");
+            handle_keys();
+        }
+        {
+            PROFILE_GPU_ZONE("texture streaming");
+            scene.get_texture_loader().update();
+        }
+        draw_scene(scene, handles, currentFrame, frame_arena, deferred_shading ? &deferred : nullptr);
+
+        {
+            PROFILE_ZONE("swap");
+            glfwSwapBuffers(window);
+        }
+        {
+            PROFILE_ZONE("events");
+            glfwPollEvents();
+        }
+        Counters::end_frame();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        allocations = AllocationCounter::get_count() - allocations;
+        if (frame++ >= ALLOCATION_WARMUP_FRAMES && allocations) {
+            fprintf(stderr, "Frame %lu made %zu heap allocations.\n", frame, allocations);
+        }
     }
 
     glfwTerminate();
     exit(EXIT_SUCCESS);
 }
 
-void draw_scene(
-    Shader shader,
-    Shader lampShader,
-    Shader wavyShader,
-    Model fish,
-    Model fish2,
-    Model fish3,
-    Model seaweed,
-    Model sand,
-    Model cube,
-    const vector<Light*>& lights
-) {
+int run_benchmark(GLFWwindow *window, Scene &scene, const SceneHandles &handles, const BenchOptions &options)
+{
+    // Streaming would land inside the measured frames, start from resident textures.
+    scene.get_texture_loader().finish();
+
+    BenchRecorder recorder(options);
+    DeferredRenderer deferred;
+    shadows_enabled = options.shadows;
+    depth_prepass = options.depthPrepass;
+    render_queue.set_sort_mode(options.frontToBack ? SortMode::FRONT_TO_BACK : SortMode::STATE);
+    lod_enabled = options.lod;
+
+    Profiler &profiler = Profiler::get();
+
+    while (recorder.running()) {
+        frame_arena.reset();
+        profiler.begin_frame();
+        if (!options.trace.empty() && recorder.measuring() && !profiler.capturing()) {
+            profiler.start_capture();
+        }
+
+        recorder.begin_frame();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        float time = recorder.get_time();
+        apply_bench_camera(camera, time);
+        draw_scene(scene, handles, time, frame_arena, options.deferred ? &deferred : nullptr);
+
+        {
+            PROFILE_ZONE("swap");
+            glfwSwapBuffers(window);
+        }
+        // Shadow, pre-pass, overlay and deferred lighting draws bypass render_queue, the counters see all of them.
+        Counters::end_frame();
+        recorder.end_frame(Counters::get(Counter::DRAW_CALLS), Counters::get(Counter::TRIANGLES));
+    }
+
+    bool written = recorder.write_report();
+    if (profiler.capturing()) {
+        profiler.stop_capture();
+        written = profiler.write_trace(options.trace) && written;
+    }
+    if (!options.counters.empty()) {
+        written = Counters::write_csv(options.counters) && written;
+    }
+    if (recorder.get_allocating_frames()) {
+        fprintf(stderr, "%u measured frames allocated on the heap, %zu allocations in total.\n",
+                recorder.get_allocating_frames(), recorder.get_allocations());
+
+        return EXIT_FAILURE;
+    }
+
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void prepare_shader_variants(Scene &scene, const SceneHandles &handles)
+{
+    // Compiling on first use stalls the frame it happens in, build every variant the scene can ask for now.
+    ShaderFeatures lighting = scene.get_light_features(), unlit {};
+
+    for (bool specularMap : {false, true}) {
+        lighting.specularMap = unlit.specularMap = specularMap;
+        for (bool shadows : {false, true}) {
+            lighting.shadows = shadows;
+            scene.get_shader(handles.shader).get(lighting);
+            scene.get_shader(handles.wavyShader).get(lighting);
+        }
+        scene.get_shader(handles.lampShader).get(unlit);
+        scene.get_shader(handles.gbufferShader).get(unlit);
+        scene.get_shader(handles.gbufferWavyShader).get(unlit);
+        scene.get_shader(handles.depthShader).get(unlit);
+        scene.get_shader(handles.depthWavyShader).get(unlit);
+        unlit.shadows = true;
+        scene.get_shader(handles.depthShader).get(unlit);
+        scene.get_shader(handles.depthInstancedShader).get(unlit);
+        unlit.shadows = false;
+    }
+
+    ShaderFeatures directional {};
+    directional.directionalLights = lighting.directionalLights;
+    for (bool shadows : {false, true}) {
+        directional.shadows = shadows;
+        scene.get_shader(handles.deferredDirectionalShader).get(directional);
+    }
+    scene.get_shader(handles.deferredPointShader).get(ShaderFeatures{});
+}
+
+void draw_scene(Scene &scene, const SceneHandles &handles, float time, FrameArena &arena, DeferredRenderer *deferred)
+{
+    PROFILE_ZONE("draw scene");
+
+    ShaderVariants &shader = scene.get_shader(deferred ? handles.gbufferShader : handles.shader);
+    ShaderVariants &lampShader = scene.get_shader(handles.lampShader);
+    ShaderVariants &wavyShader = scene.get_shader(deferred ? handles.gbufferWavyShader : handles.wavyShader);
+
     glm::mat4 projection = glm::perspective(glm::radians(camera.get_fov()), 800.0f/600.0f, 0.1f, 100.0f);
     glm::mat4 view = camera.get_view_matrix();
+    float n = time;
 
-    shader.use();
-
-    shader.setUniformMatrix("projection", projection);
-    shader.setUniformMatrix("view", view);
-    shader.setUniformVec3("viewPos", camera.get_position());
-
-    int i = 0;
-    for (auto light : lights) {
-        shader.use();
-        shader.setUniformInt("lights[" + std::to_string(i) + "].type", static_cast<int>(light->get_type()));
-        shader.setUniformVec3("lights[" + std::to_string(i) + "].ambient", light->get_ambient());
-        shader.setUniformVec3("lights[" + std::to_string(i) + "].diffuse", light->get_diffuse());
-        shader.setUniformVec3("lights[" + std::to_string(i) + "].specular", light->get_specular());
-
-        wavyShader.use();
-        wavyShader.setUniformInt("lights[" + std::to_string(i) + "].type", static_cast<int>(light->get_type()));
-        wavyShader.setUniformVec3("lights[" + std::to_string(i) + "].ambient", light->get_ambient());
-        wavyShader.setUniformVec3("lights[" + std::to_string(i) + "].diffuse", light->get_diffuse());
-        wavyShader.setUniformVec3("lights[" + std::to_string(i) + "].specular", light->get_specular());
-
-        switch (light->get_type()) {
-            case LightType::DIRECTIONAL:
-                shader.use();
-                shader.setUniformVec3("lights[" + std::to_string(i) + "].direction", light->get_direction());
-                wavyShader.use();
-                wavyShader.setUniformVec3("lights[" + std::to_string(i) + "].direction", light->get_direction());
-                shader.use();
-                break;
-            case LightType::POINT:
-                shader.use();
-                shader.setUniformVec3("lights[" + std::to_string(i) + "].position", light->get_position());
-                shader.setUniformFloat("lights[" + std::to_string(i) + "].constant", light->get_constant());
-                shader.setUniformFloat("lights[" + std::to_string(i) + "].linear", light->get_linear());
-                shader.setUniformFloat("lights[" + std::to_string(i) + "].quadratic", light->get_quadratic());
-                wavyShader.use();
-                wavyShader.setUniformVec3("lights[" + std::to_string(i) + "].position", light->get_position());
-                wavyShader.setUniformFloat("lights[" + std::to_string(i) + "].constant", light->get_constant());
-                wavyShader.setUniformFloat("lights[" + std::to_string(i) + "].linear", light->get_linear());
-                wavyShader.setUniformFloat("lights[" + std::to_string(i) + "].quadratic", light->get_quadratic());
-
-                lampShader.use();
-
-                glm::mat4 lampMatrix = glm::mat4(1.0f);
-                lampMatrix = glm::translate(lampMatrix, light->get_position());
-                lampMatrix = glm::scale(lampMatrix, glm::vec3(0.2f));
-
-                lampShader.setUniformMatrix("projection", projection);
-                lampShader.setUniformMatrix("view", view);
-                lampShader.setUniformMatrix("model", lampMatrix);
-
-                lampShader.setUniformVec3("color", light->get_specular());
-
-                cube.draw(lampShader);
-
-                shader.use();
+    {
+        PROFILE_GPU_ZONE("uniform upload");
+        scene.update_frame(projection, view, camera.get_position(), n);
+        scene.update_lights();
+    }
+    // The G-buffer shaders only vary with the material.
+    ShaderFeatures lighting = deferred ? ShaderFeatures{} : scene.get_light_features();
+    lighting.shadows = shadows_enabled && !deferred && sun;
+
+    glm::vec3 cameraPosition = camera.get_position();
+    render_queue.clear();
+    overlay_queue.clear();
+    depth_queue.clear();
+    RenderQueue &lampQueue = deferred ? overlay_queue : render_queue;
+
+    // Every forward draw is mirrored into depth_queue with a position only shader.
+    bool prepass = depth_prepass && !deferred;
+    bool frontToBack = prepass || render_queue.get_sort_mode() == SortMode::FRONT_TO_BACK;
+    ShaderVariants &depthShader = scene.get_shader(handles.depthShader);
+    depth_queue.set_sort_mode(SortMode::FRONT_TO_BACK);
+
+    for (Light *light : lamps) {
+        glm::mat4 lampMatrix = glm::mat4(1.0f);
+        lampMatrix = glm::translate(lampMatrix, light->get_position());
+        lampMatrix = glm::scale(lampMatrix, glm::vec3(0.2f));
+
+        float depth = glm::length(light->get_position() - cameraPosition);
+        lampQueue.submit(lampShader, ShaderFeatures{}, scene.get_model(handles.cube), lampMatrix, depth, light->get_specular());
+        if (prepass) {
+            depth_queue.submit(depthShader, ShaderFeatures{}, scene.get_model(handles.cube), lampMatrix, depth);
         }
-
-        i++;
     }
 
+    const int objectCount = OBJECT_COUNT;
+    ModelHandle objects[objectCount] = {handles.fish, handles.fish2, handles.fish3, handles.sand};
+    glm::mat4 transforms[objectCount];
+
     glm::mat4 modelMatrix = glm::mat4(1.0f);
 
-    auto n = (float)glfwGetTime();
     modelMatrix = glm::translate(modelMatrix, glm::vec3(
             cos(n / 2) * 5,
             1.0f,
@@ -227,8 +394,7 @@ void draw_scene(
     ));
     modelMatrix = glm::rotate(modelMatrix, (-n/2) + (sin(n * 2) * cos(n * 2) / 2), glm::vec3(0,1,0));
     modelMatrix = glm::scale(modelMatrix, glm::vec3(0.2f, 0.2f, 0.2f));
-    shader.setUniformMatrix("model", modelMatrix);
-    fish.draw(shader);
+    transforms[0] = modelMatrix;
 
     modelMatrix = glm::mat4(1.0f);
 
@@ -239,8 +405,7 @@ void draw_scene(
     ));
     modelMatrix = glm::rotate(modelMatrix, 3.14f + (n/3) + (sin(n * 2) * cos(n * 2) / 2), glm::vec3(0,1,0));
     modelMatrix = glm::scale(modelMatrix, glm::vec3(0.12f, 0.12f, 0.2f));
-    shader.setUniformMatrix("model", modelMatrix);
-    fish2.draw(shader);
+    transforms[1] = modelMatrix;
 
     modelMatrix = glm::mat4(1.0f);
 
@@ -251,34 +416,193 @@ void draw_scene(
     ));
     modelMatrix = glm::rotate(modelMatrix, (-n/4) + (sin(n * 2) * cos(n * 2) / 2), glm::vec3(0,1,0));
     modelMatrix = glm::scale(modelMatrix, glm::vec3(0.6f, 0.2f, 0.2f));
-    shader.setUniformMatrix("model", modelMatrix);
-    fish3.draw(shader);
+    transforms[2] = modelMatrix;
 
-    modelMatrix = glm::mat4(1.0f);
-    modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f));
-    modelMatrix = glm::scale(modelMatrix, glm::vec3(10.0f, 1.0f, 10.0f));
-    shader.setUniformMatrix("model", modelMatrix);
-    sand.draw(shader);
+    transforms[3] = sand_transform;
 
-    wavyShader.use();
-    for (Seaweed instance : seaweed_data) {
-        modelMatrix = glm::mat4(1.0f);
+    int width, height;
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+    float pixelScale = lod_pixel_scale(projection, height);
 
-        modelMatrix = glm::translate(modelMatrix,glm::vec3(
-                instance.coords.x,
-                0.0f,
-                instance.coords.y
-        ));
-        modelMatrix = glm::rotate(modelMatrix, instance.rotation, glm::vec3(0,1,0));
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(instance.scale));
+    // Picked before the shadow pass, the fish cast shadows at the level they are drawn at.
+    Bounds objectBounds[objectCount];
+    for (int i = 0; i < objectCount; i++) {
+        const Model &model = scene.get_model(objects[i]);
+        objectBounds[i] = model.get_bounds().transformed(transforms[i]);
+
+        float radius = projected_radius(objectBounds[i].center, objectBounds[i].radius, cameraPosition, pixelScale);
+        object_lods[i] = lod_enabled ? select_lod(model.get_lod_errors(), radius, object_lods[i]) : 0;
+    }
+
+    if (shadows_enabled && sun) {
+        PROFILE_ZONE("shadows");
+        draw_shadow_maps(scene, handles, objects, transforms, objectBounds, object_lods, 3, arena, width, height);
+    }
+
+    Frustum frustum(projection * view);
+
+    {
+        PROFILE_ZONE("object culling");
+        object_culling.clear();
+        for (int i = 0; i < objectCount; i++) {
+            object_culling.add(objectBounds[i]);
+        }
+        object_culling.cull(frustum);
+    }
 
-        wavyShader.setUniformMatrix("projection", projection);
-        wavyShader.setUniformMatrix("view", view);
-        wavyShader.setUniformMatrix("model", modelMatrix);
-        wavyShader.setUniformFloat("currentTime", n);
+    for (unsigned int index : object_culling.get_visible()) {
+        float depth = glm::length(glm::vec3(transforms[index][3]) - cameraPosition);
+        const Model &model = scene.get_model(objects[index]);
+        render_queue.submit(shader, lighting, model, transforms[index], depth, glm::vec3(1.0f), object_lods[index]);
+        if (prepass) {
+            depth_queue.submit(depthShader, ShaderFeatures{}, model, transforms[index], depth, glm::vec3(1.0f), object_lods[index]);
+        }
+    }
 
-        seaweed.draw(wavyShader);
+    Model &seaweed = scene.get_model(handles.seaweed);
+    FrameVector<unsigned int> seaweedOrder {ArenaAllocator<unsigned int>(arena)};
+    {
+        PROFILE_ZONE("seaweed culling");
+        const vector<unsigned int> &visible = seaweed_culling.cull(frustum);
+        seaweedOrder.assign(visible.begin(), visible.end());
+
+        // Instances rasterize in order, nearest first lets the early depth test reject the plants behind.
+        if (frontToBack) {
+            std::sort(seaweedOrder.begin(), seaweedOrder.end(), [&](unsigned int a, unsigned int b) {
+                glm::vec3 toA = glm::vec3(seaweed_instances[a][3]) - cameraPosition;
+                glm::vec3 toB = glm::vec3(seaweed_instances[b][3]) - cameraPosition;
+                return glm::dot(toA, toA) < glm::dot(toB, toB);
+            });
+        }
     }
+    float seaweedDepth = seaweedOrder.empty() ? 0.0f : glm::length(glm::vec3(seaweed_instances[seaweedOrder[0]][3]) - cameraPosition);
+
+    FrameVector<glm::mat4> seaweedVisible {ArenaAllocator<glm::mat4>(arena)};
+    GLsizei seaweedLodCounts[MAX_MESH_LODS] = {};
+    {
+        PROFILE_ZONE("seaweed lod");
+        const Bounds &bounds = seaweed.get_bounds();
+        for (unsigned int index : seaweedOrder) {
+            unsigned int lod = 0;
+            if (lod_enabled) {
+                glm::vec3 center = glm::vec3(seaweed_instances[index] * glm::vec4(bounds.center, 1.0f));
+                float radius = projected_radius(center, bounds.radius * seaweed_data[index].scale, cameraPosition, pixelScale);
+                lod = select_lod(seaweed.get_lod_errors(), radius, seaweed_lods[index]);
+            }
+            seaweed_lods[index] = lod;
+            seaweedLodCounts[lod]++;
+        }
+
+        // One run per level, a counting sort keeps the front to back order inside each run.
+        GLsizei offsets[MAX_MESH_LODS] = {};
+        for (unsigned int lod = 1; lod < MAX_MESH_LODS; lod++) {
+            offsets[lod] = offsets[lod - 1] + seaweedLodCounts[lod - 1];
+        }
+        seaweedVisible.resize(seaweedOrder.size());
+        for (unsigned int index : seaweedOrder) {
+            seaweedVisible[offsets[seaweed_lods[index]]++] = seaweed_instances[index];
+        }
+    }
+
+    {
+        PROFILE_GPU_ZONE("instance upload");
+        seaweed.set_instances(seaweedVisible.data(), (GLsizei)seaweedVisible.size(), seaweedLodCounts);
+    }
+
+    render_queue.submit_instanced(wavyShader, lighting, seaweed, frontToBack ? seaweedDepth : 0.0f);
+    if (prepass) {
+        depth_queue.submit_instanced(scene.get_shader(handles.depthWavyShader), ShaderFeatures{}, seaweed, seaweedDepth);
+    }
+
+    if (!deferred) {
+        if (prepass) {
+            PROFILE_GPU_ZONE("depth pre-pass");
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            depth_queue.flush();
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            // Only the nearest surface of every pixel passes, each runs the lighting once.
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        render_queue.flush();
+        if (prepass) {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+        return;
+    }
+
+    {
+        PROFILE_GPU_ZONE("gbuffer pass");
+        deferred->begin_geometry(width, height);
+        render_queue.flush();
+        deferred->end_geometry();
+    }
+
+    ShaderFeatures directional {};
+    directional.directionalLights = scene.get_light_features().directionalLights;
+    directional.shadows = shadows_enabled && sun;
+    deferred->light(
+        scene.get_shader(handles.deferredDirectionalShader).get(directional),
+        scene.get_shader(handles.deferredPointShader).get(ShaderFeatures{}),
+        projection * view,
+        scene.get_light_clusters().get_light_data()
+    );
+    overlay_queue.flush();
+}
+
+void draw_shadow_maps(Scene &scene, const SceneHandles &handles, const ModelHandle *fish, const glm::mat4 *fishTransforms,
+                      const Bounds *fishBounds, const unsigned int *fishLods, int fishCount, FrameArena &arena, int width, int height)
+{
+    ShadowMap &shadows = scene.get_shadow_map();
+    shadows.update(sun->get_direction(), shadow_bounds);
+    Frustum lightFrustum(shadows.get_light_space());
+
+    ShaderVariants &depthShader = scene.get_shader(handles.depthShader);
+    ShaderFeatures lightSpace {};
+    lightSpace.shadows = true;
+
+    // Sand and seaweed only change with the light, the swaying tops move too little to show.
+    if (!shadows.static_valid()) {
+        PROFILE_GPU_ZONE("static shadow map");
+        shadow_queue.clear();
+        shadow_queue.submit(depthShader, lightSpace, scene.get_model(handles.sand), sand_transform, 0.0f);
+
+        FrameVector<glm::mat4> casters {ArenaAllocator<glm::mat4>(arena)};
+        const vector<unsigned int> &visible = seaweed_culling.cull(lightFrustum);
+        casters.reserve(visible.size());
+        for (unsigned int index : visible) {
+            casters.push_back(seaweed_instances[index]);
+        }
+
+        Model &seaweed = scene.get_model(handles.seaweed);
+        seaweed.set_instances(casters.data(), (GLsizei)casters.size());
+        shadow_queue.submit_instanced(scene.get_shader(handles.depthInstancedShader), lightSpace, seaweed, 0.0f);
+
+        shadows.begin_static();
+        shadow_queue.flush();
+        shadows.end(width, height);
+    }
+
+    {
+        PROFILE_GPU_ZONE("dynamic shadow map");
+        shadow_queue.clear();
+        object_culling.clear();
+        for (int i = 0; i < fishCount; i++) {
+            object_culling.add(fishBounds[i]);
+        }
+        for (unsigned int index : object_culling.cull(lightFrustum)) {
+            shadow_queue.submit(depthShader, lightSpace, scene.get_model(fish[index]), fishTransforms[index], 0.0f,
+                                glm::vec3(1.0f), fishLods[index]);
+        }
+
+        shadows.begin_dynamic();
+        shadow_queue.flush();
+        shadows.end(width, height);
+    }
+
+    shadows.bind();
 }
 
 void handle_keys()
@@ -294,6 +618,55 @@ void handle_keys()
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod)
 {
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+        const RenderStats &stats = render_queue.get_stats();
+        fprintf(stdout, "Draws: %u packets, %u draw calls, %u state changes, %u redundant changes skipped.\n",
+                stats.packets, stats.drawCalls, stats.stateChanges, stats.stateChangesAvoided);
+    }
+
+    if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+        deferred_shading = !deferred_shading;
+        fprintf(stdout, "Switched to %s shading.\n", deferred_shading ? "deferred" : "forward");
+    }
+
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+        shadows_enabled = !shadows_enabled;
+        fprintf(stdout, "Shadows %s.\n", shadows_enabled ? "enabled" : "disabled");
+    }
+
+    if (key == GLFW_KEY_F6 && action == GLFW_PRESS) {
+        depth_prepass = !depth_prepass;
+        fprintf(stdout, "Depth pre-pass %s.\n", depth_prepass ? "enabled" : "disabled");
+    }
+
+    if (key == GLFW_KEY_F7 && action == GLFW_PRESS) {
+        bool frontToBack = render_queue.get_sort_mode() == SortMode::STATE;
+        render_queue.set_sort_mode(frontToBack ? SortMode::FRONT_TO_BACK : SortMode::STATE);
+        fprintf(stdout, "Sorting draws %s.\n", frontToBack ? "front to back" : "by state");
+    }
+
+    if (key == GLFW_KEY_F8 && action == GLFW_PRESS) {
+        lod_enabled = !lod_enabled;
+        fprintf(stdout, "Detail levels %s.\n", lod_enabled ? "enabled" : "disabled");
+    }
+
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+        Profiler &profiler = Profiler::get();
+        if (profiler.capturing()) {
+            profiler.stop_capture();
+            if (profiler.write_trace(TRACE_PATH)) {
+                fprintf(stdout, "Wrote profiler capture to %s.\n", TRACE_PATH);
+            }
+        } else {
+            profiler.start_capture();
+            fprintf(stdout, "Profiler capture started, press F2 again to stop.\n");
+        }
+    }
+
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS && Counters::write_csv(COUNTERS_PATH)) {
+        fprintf(stdout, "Wrote the last %d frames of counters to %s.\n", COUNTER_HISTORY, COUNTERS_PATH);
+    }
+
     if (action == GLFW_PRESS) {
         pressed_keys.push_back(key);
     } else if (action == GLFW_RELEASE) {
@@ -316,16 +689,16 @@ void remove_vector_value(int value, vector<int> &vec)
     vec.erase(std::remove(vec.begin(), vec.end(), value), vec.end());
 }
 
-vector<Light*> generate_lights() {
-    std::vector<Light*> lights;
+void generate_lights(Scene &scene) {
 
-    lights.push_back(new DirectionalLight(
+    sun = new DirectionalLight(
             glm::vec3(-0.2f, -1.0f, -0.3f),
             glm::vec3(0.05f),
             glm::vec3(0.4f),
             glm::vec3(0.5f)
-    ));
-    lights.push_back(new PointLight(
+    );
+    scene.add_light(sun);
+    lamps.push_back(new PointLight(
             glm::vec3(0.0f, 2.0f, 0.0f),
             1.0f,
             0.09f,
@@ -334,7 +707,7 @@ vector<Light*> generate_lights() {
             glm::vec3(0.8f, 0.8f, 0.8f),
             glm::vec3(1.0f, 1.0f, 1.0f)
     ));
-    lights.push_back(new PointLight(
+    lamps.push_back(new PointLight(
             glm::vec3(8.1f, 2.0f, 8.1f),
             1.0f,
             0.09f,
@@ -343,7 +716,7 @@ vector<Light*> generate_lights() {
             glm::vec3(0.2f, 0.8f, 0.2f),
             glm::vec3(0.3f, 1.0f, 0.3f)
     ));
-    lights.push_back(new PointLight(
+    lamps.push_back(new PointLight(
             glm::vec3(-8.1f, 0.4f, -8.1f),
             1.0f,
             0.09f,
@@ -352,8 +725,30 @@ vector<Light*> generate_lights() {
             glm::vec3(0.8f, 0.8f, 0.8f),
             glm::vec3(1.0f, 1.0f, 1.0f)
     ));
+    for (Light *lamp : lamps) {
+        scene.add_light(lamp);
+    }
 
-    return lights;
+    // Small bioluminescent lights over the sand, each only reaches the clusters within its range.
+    std::default_random_engine generator(7);
+    std::uniform_real_distribution<float> coordsDistribution(-10,10);
+    std::uniform_real_distribution<float> heightDistribution(0.1,1.5);
+    std::uniform_real_distribution<float> hueDistribution(0,1);
+
+    for (int i = 0; i < GLOW_LIGHT_COUNT; i++) {
+        glm::vec3 color = glm::mix(glm::vec3(0.1f, 0.9f, 0.7f), glm::vec3(0.3f, 0.4f, 1.0f), hueDistribution(generator));
+        glm::vec3 position(coordsDistribution(generator), heightDistribution(generator), coordsDistribution(generator));
+
+        scene.add_light(new PointLight(
+                position,
+                1.0f,
+                1.4f,
+                20.0f,
+                glm::vec3(0.0f),
+                color * 0.6f,
+                color * 0.6f
+        ));
+    }
 }
 
 void generate_seaweed() {
@@ -362,7 +757,7 @@ void generate_seaweed() {
     std::uniform_real_distribution<float> scaleDistribution(0.3,0.7);
     std::uniform_real_distribution<float> rotationDistribution(-0.2,0.2);
 
-    for (int i = 0; i < 200; i++) {
+    for (int i = 0; i < SEAWEED_COUNT; i++) {
         Seaweed seaweed{};
         seaweed.coords = glm::vec2(coordsDistribution(generator), coordsDistribution(generator));
         seaweed.scale = scaleDistribution(generator);
@@ -371,3 +766,44 @@ void generate_seaweed() {
         seaweed_data.push_back(seaweed);
     }
 }
+
+vector<glm::mat4> seaweed_transforms() {
+    vector<glm::mat4> transforms;
+    transforms.reserve(seaweed_data.size());
+
+    for (const Seaweed &instance : seaweed_data) {
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+
+        modelMatrix = glm::translate(modelMatrix,glm::vec3(
+                instance.coords.x,
+                0.0f,
+                instance.coords.y
+        ));
+        modelMatrix = glm::rotate(modelMatrix, instance.rotation, glm::vec3(0,1,0));
+        modelMatrix = glm::scale(modelMatrix, glm::vec3(instance.scale));
+
+        transforms.push_back(modelMatrix);
+    }
+
+    return transforms;
+}
+
+void prepare_seaweed_culling(const Bounds &bounds) {
+    // The vertex shader sways the tops of the plants, grow the sphere to cover it.
+    Bounds swaying = bounds;
+    swaying.radius += SEAWEED_WAVE_AMPLITUDE;
+
+    seaweed_culling.reserve(seaweed_instances.size());
+    for (const glm::mat4 &instance : seaweed_instances) {
+        seaweed_culling.add(swaying.transformed(instance));
+    }
+}
+
+void prepare_shadow_bounds(Scene &scene, const SceneHandles &handles) {
+    shadow_bounds = scene.get_model(handles.sand).get_bounds().transformed(sand_transform);
+
+    const Bounds &seaweed = scene.get_model(handles.seaweed).get_bounds();
+    for (const glm::mat4 &instance : seaweed_instances) {
+        shadow_bounds.add(seaweed.transformed(instance));
+    }
+}
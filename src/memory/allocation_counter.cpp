@@ -0,0 +1,69 @@
+#include "allocation_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef FPS_COUNT_ALLOCATIONS
+
+static std::atomic<size_t> ALLOCATIONS {0};
+
+void *operator new(size_t size)
+{
+    ALLOCATIONS.fetch_add(1, std::memory_order_relaxed);
+
+    void *memory = std::malloc(size ? size : 1);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+bool AllocationCounter::enabled()
+{
+    return true;
+}
+
+size_t AllocationCounter::get_count()
+{
+    return ALLOCATIONS.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationCounter::enabled()
+{
+    return false;
+}
+
+size_t AllocationCounter::get_count()
+{
+    return 0;
+}
+
+#endif
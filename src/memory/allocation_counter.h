@@ -0,0 +1,15 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// Counts calls to the global operator new when built with FPS_COUNT_ALLOCATIONS,
+// always reports zero otherwise.
+class AllocationCounter
+{
+    public:
+        static bool enabled();
+        static size_t get_count();
+};
+
+#endif
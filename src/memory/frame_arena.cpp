@@ -0,0 +1,72 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+FrameArena::FrameArena(size_t capacity)
+{
+    CAPACITY = capacity;
+    BUFFER = static_cast<unsigned char *>(std::malloc(CAPACITY));
+    OVERFLOW.reserve(16);
+}
+
+FrameArena::~FrameArena()
+{
+    reset();
+    std::free(BUFFER);
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    size_t start = (OFFSET + alignment - 1) & ~(alignment - 1);
+    // Upper bound of what this frame would need from one buffer, alignment padding included.
+    REQUESTED += size + alignment - 1;
+
+    if (BUFFER && start + size <= CAPACITY) {
+        OFFSET = start + size;
+        return BUFFER + start;
+    }
+
+    void *memory = std::malloc(size ? size : 1);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    OVERFLOW.push_back(memory);
+
+    return memory;
+}
+
+void FrameArena::reset()
+{
+    for (void *memory : OVERFLOW) {
+        std::free(memory);
+    }
+    OVERFLOW.clear();
+
+    HIGH_WATER = std::max(HIGH_WATER, REQUESTED);
+
+    // Grow once with headroom, later frames of the same size fit without overflowing.
+    if (REQUESTED > CAPACITY) {
+        std::free(BUFFER);
+        CAPACITY = REQUESTED + REQUESTED / 2;
+        BUFFER = static_cast<unsigned char *>(std::malloc(CAPACITY));
+    }
+
+    OFFSET = 0;
+    REQUESTED = 0;
+}
+
+size_t FrameArena::get_capacity() const
+{
+    return CAPACITY;
+}
+
+size_t FrameArena::get_used() const
+{
+    return OFFSET;
+}
+
+size_t FrameArena::get_high_water() const
+{
+    return HIGH_WATER;
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+#define FRAME_ARENA_SIZE (256 * 1024)
+
+// Bump allocator for data that lives for one frame. Requests past the capacity fall back to the heap
+// and make the next reset() grow the buffer, so a steady-state frame never touches the heap.
+class FrameArena
+{
+    private:
+        unsigned char  *BUFFER = nullptr;
+        size_t         CAPACITY = 0,
+                       OFFSET = 0,
+                       REQUESTED = 0,
+                       HIGH_WATER = 0;
+        vector<void *> OVERFLOW;
+
+    public:
+        explicit FrameArena(size_t capacity = FRAME_ARENA_SIZE);
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+        ~FrameArena();
+
+        void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+        // Invalidates everything allocated since the previous reset.
+        void reset();
+
+        size_t get_capacity() const;
+        size_t get_used() const;
+        size_t get_high_water() const;
+};
+
+// Standard allocator over a FrameArena, deallocation is a no-op until the arena resets.
+template<typename T>
+class ArenaAllocator
+{
+    public:
+        typedef T value_type;
+
+        FrameArena *ARENA;
+
+        explicit ArenaAllocator(FrameArena &arena) : ARENA(&arena) {}
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : ARENA(other.ARENA) {}
+
+        T *allocate(size_t count)
+        {
+            return static_cast<T *>(ARENA->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *, size_t) {}
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U> &other) const { return ARENA == other.ARENA; }
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const { return ARENA != other.ARENA; }
+};
+
+template<typename T>
+using FrameVector = vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,139 @@
+#include "asset_registry.h"
+#include <cstdio>
+#include <sys/stat.h>
+#include "../util/hash.h"
+#include "mesh_optimizer.h"
+#include "../profile/counters.h"
+
+GeometryBuffers::~GeometryBuffers()
+{
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+}
+
+TextureAsset::~TextureAsset()
+{
+    glDeleteTextures(1, &id);
+}
+
+AssetRegistry::AssetRegistry(TextureLoader &textureLoader) : TEXTURE_LOADER(textureLoader)
+{
+}
+
+shared_ptr<GeometryBuffers> AssetRegistry::get_geometry(const void *vertices, GLsizei vertexCount, VertexFormat format,
+                                                        const Quantization &quantization,
+                                                        const unsigned int *indices, GLsizei indexCount)
+{
+    GLsizeiptr vertexSize = vertexCount * (GLsizeiptr)vertex_size(format);
+    GLsizeiptr indexSize = indexCount * (GLsizeiptr)sizeof(unsigned int);
+
+    // Counts are mixed in so a vertex/index split at a different point cannot collide.
+    uint64_t key = hash_bytes(&vertexCount, sizeof(vertexCount));
+    key = hash_bytes(&format, sizeof(format), key);
+    key = hash_bytes(&quantization, sizeof(quantization), key);
+    key = hash_bytes(vertices, (size_t)vertexSize, key);
+    key = hash_bytes(indices, (size_t)indexSize, key);
+
+    shared_ptr<GeometryBuffers> geometry = GEOMETRY[key].lock();
+    if (geometry) {
+        STATS.geometryHits++;
+        STATS.bytesSaved += (size_t)geometry->size;
+
+        return geometry;
+    }
+
+    // Indices are hashed as 32 bit above and narrowed on upload when every vertex fits.
+    vector<unsigned short> shortIndices;
+    const void *indexData = indices;
+    if (vertexCount <= SHORT_INDEX_VERTEX_LIMIT) {
+        shortIndices.assign(indices, indices + indexCount);
+        indexData = shortIndices.data();
+        indexSize = indexCount * (GLsizeiptr)sizeof(unsigned short);
+    }
+
+    geometry = std::make_shared<GeometryBuffers>();
+    geometry->size = vertexSize + indexSize;
+    geometry->indexType = shortIndices.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    geometry->format = format;
+    geometry->quantization = quantization;
+
+    glGenBuffers(1, &geometry->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry->vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexSize, vertices, GL_STATIC_DRAW);
+
+    // The element binding is VAO state, keep it out of whatever VAO happens to be bound.
+    glBindVertexArray(0);
+    glGenBuffers(1, &geometry->ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, indexData, GL_STATIC_DRAW);
+
+    Counters::add(Counter::BUFFER_BYTES_UPLOADED, (uint64_t)geometry->size);
+    STATS.geometryMisses++;
+    GEOMETRY[key] = geometry;
+
+    return geometry;
+}
+
+bool AssetRegistry::hash_texture_file(const string &path, uint64_t &hash, GLsizeiptr &size)
+{
+    struct stat info {};
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    size = (GLsizeiptr)info.st_size;
+
+    auto known = FILE_HASHES.find(path);
+    if (known != FILE_HASHES.end()) {
+        hash = known->second;
+
+        return true;
+    }
+
+    if (!hash_file(path, hash)) {
+        return false;
+    }
+    FILE_HASHES[path] = hash;
+
+    return true;
+}
+
+shared_ptr<TextureAsset> AssetRegistry::get_texture(const string &path)
+{
+    uint64_t key;
+    GLsizeiptr size;
+    if (!hash_texture_file(path, key, size)) {
+        fprintf(stderr, "Failed to read texture %s.\n", path.c_str());
+
+        return nullptr;
+    }
+
+    shared_ptr<TextureAsset> texture = TEXTURES[key].lock();
+    if (texture) {
+        STATS.textureHits++;
+        STATS.bytesSaved += (size_t)texture->size;
+
+        return texture;
+    }
+
+    texture = std::make_shared<TextureAsset>();
+    texture->id = TEXTURE_LOADER.load(path);
+    texture->size = size;
+
+    STATS.textureMisses++;
+    TEXTURES[key] = texture;
+
+    return texture;
+}
+
+const AssetStats &AssetRegistry::get_stats() const
+{
+    return STATS;
+}
+
+void AssetRegistry::print_report() const
+{
+    fprintf(stdout, "Assets: %u/%u geometry and %u/%u textures shared, %zu bytes saved.\n",
+            STATS.geometryHits, STATS.geometryHits + STATS.geometryMisses,
+            STATS.textureHits, STATS.textureHits + STATS.textureMisses,
+            STATS.bytesSaved);
+}
@@ -0,0 +1,77 @@
+#ifndef ASSET_REGISTRY_H
+#define ASSET_REGISTRY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <glad/glad.h>
+#include "mesh.h"
+#include "texture_loader.h"
+
+using std::string;
+using std::shared_ptr;
+using std::weak_ptr;
+using std::unordered_map;
+
+// GL objects are released when the last handle to them goes away.
+struct GeometryBuffers {
+    GLuint       vbo = 0,
+                 ebo = 0;
+    GLsizeiptr   size = 0;
+    GLenum       indexType = GL_UNSIGNED_INT;
+    VertexFormat format = VertexFormat::FLOAT;
+    Quantization quantization;
+
+    GeometryBuffers() = default;
+    GeometryBuffers(const GeometryBuffers&) = delete;
+    GeometryBuffers& operator=(const GeometryBuffers&) = delete;
+    ~GeometryBuffers();
+};
+
+struct TextureAsset {
+    GLuint     id = 0;
+    GLsizeiptr size = 0;
+
+    TextureAsset() = default;
+    TextureAsset(const TextureAsset&) = delete;
+    TextureAsset& operator=(const TextureAsset&) = delete;
+    ~TextureAsset();
+};
+
+struct AssetStats {
+    unsigned int geometryHits, geometryMisses,
+                 textureHits, textureMisses;
+    size_t       bytesSaved;
+};
+
+// Deduplicates geometry and textures by content hash, so identical assets from different
+// directories share one GL buffer or texture.
+class AssetRegistry
+{
+    private:
+        TextureLoader                                   &TEXTURE_LOADER;
+        unordered_map<uint64_t, weak_ptr<GeometryBuffers>> GEOMETRY;
+        unordered_map<uint64_t, weak_ptr<TextureAsset>>    TEXTURES;
+        unordered_map<string, uint64_t>                    FILE_HASHES;
+        AssetStats                                         STATS{};
+
+        bool hash_texture_file(const string &path, uint64_t &hash, GLsizeiptr &size);
+
+    public:
+        explicit AssetRegistry(TextureLoader &textureLoader);
+        AssetRegistry(const AssetRegistry&) = delete;
+        AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+        // Vertices are laid out in the given format already.
+        shared_ptr<GeometryBuffers> get_geometry(const void *vertices, GLsizei vertexCount, VertexFormat format,
+                                                 const Quantization &quantization,
+                                                 const unsigned int *indices, GLsizei indexCount);
+        // Returns nullptr when the file cannot be read.
+        shared_ptr<TextureAsset> get_texture(const string &path);
+
+        const AssetStats &get_stats() const;
+        void print_report() const;
+};
+
+#endif
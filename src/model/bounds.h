@@ -0,0 +1,76 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <algorithm>
+#include <cfloat>
+#include <glm/glm.hpp>
+
+struct Bounds {
+    glm::vec3 min{FLT_MAX};
+    glm::vec3 max{-FLT_MAX};
+    glm::vec3 center{};
+    float     radius = 0.0f;
+
+    bool empty() const
+    {
+        return min.x > max.x;
+    }
+
+    void add(glm::vec3 point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void add(const Bounds &other)
+    {
+        if (other.empty()) {
+            return;
+        }
+
+        add(other.min);
+        add(other.max);
+    }
+
+    // Centres the sphere on the box, the radius has to be grown by the caller with fit_sphere().
+    void finish()
+    {
+        center = (min + max) * 0.5f;
+        radius = 0.0f;
+    }
+
+    void fit_sphere(glm::vec3 point)
+    {
+        radius = std::max(radius, glm::length(point - center));
+    }
+
+    void fit_sphere(const Bounds &other)
+    {
+        radius = std::max(radius, glm::length(other.center - center) + other.radius);
+    }
+
+    // World space bounds of the box and sphere under an affine transform.
+    Bounds transformed(const glm::mat4 &transform) const
+    {
+        Bounds result;
+        result.center = glm::vec3(transform * glm::vec4(center, 1.0f));
+
+        float scale = std::max(
+            glm::length(glm::vec3(transform[0])),
+            std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])))
+        );
+        result.radius = radius * scale;
+
+        glm::vec3 extent = (max - min) * 0.5f;
+        glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x
+                              + glm::abs(glm::vec3(transform[1])) * extent.y
+                              + glm::abs(glm::vec3(transform[2])) * extent.z;
+        glm::vec3 worldCenter = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.0f));
+        result.min = worldCenter - worldExtent;
+        result.max = worldCenter + worldExtent;
+
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "material.h"
+
+static unsigned int NEXT_MATERIAL_ID = 1;
+
+Material::Material()
+{
+    ID = NEXT_MATERIAL_ID++;
+}
+
+bool Material::add_texture(const string &typeName, GLuint texture)
+{
+    int slot = texture_slot(typeName);
+    if (slot < 0 || COUNTS[slot] == TEXTURES_PER_TYPE) {
+        return false;
+    }
+
+    TEXTURES[slot * TEXTURES_PER_TYPE + COUNTS[slot]++] = texture;
+
+    return true;
+}
+
+bool Material::has(TextureSlot slot) const
+{
+    return COUNTS[static_cast<int>(slot)] > 0;
+}
+
+unsigned int Material::get_id() const
+{
+    return ID;
+}
+
+void Material::bind(StateCache &cache) const
+{
+    for (GLuint unit = 0; unit < MATERIAL_TEXTURE_UNITS; unit++) {
+        if (TEXTURES[unit]) {
+            cache.bind_texture(unit, TEXTURES[unit]);
+        }
+    }
+}
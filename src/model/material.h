@@ -0,0 +1,29 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+#include <string>
+#include "../shader/texture_units.h"
+#include "../render/state_cache.h"
+
+using std::string;
+
+class Material
+{
+    private:
+        unsigned int ID;
+        GLuint       TEXTURES[MATERIAL_TEXTURE_UNITS] {};
+        int          COUNTS[TEXTURE_SLOT_COUNT] {};
+
+    public:
+        Material();
+
+        // Assigns the texture to the next free unit of its type, returns false when the type is full or unknown.
+        bool add_texture(const string &typeName, GLuint texture);
+        bool has(TextureSlot slot) const;
+        unsigned int get_id() const;
+
+        void bind(StateCache &cache) const;
+};
+
+#endif
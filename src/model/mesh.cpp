@@ -1,65 +1,122 @@
-#include <utility>
+#include <algorithm>
 #include <iostream>
-#include <map>
+#include <utility>
 #include "mesh.h"
+#include "asset_registry.h"
 
-using std::map;
-
-Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+Mesh::Mesh(shared_ptr<GeometryBuffers> geometry, const vector<MeshLod> &lods, const Material &material, const Bounds &bounds)
 {
-    VERTICES = std::move(vertices);
-    INDICES = std::move(indices);
-    TEXTURES = std::move(textures);
+    GEOMETRY = std::move(geometry);
+    BOUNDS = bounds;
+    MATERIAL = material;
+    LODS = lods;
 
     setup_mesh();
 }
 
 void Mesh::setup_mesh()
 {
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
-    glBufferData(GL_ARRAY_BUFFER, VERTICES.size() * sizeof(Vertex), &VERTICES[0], GL_STATIC_DRAW);
 
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, INDICES.size() * sizeof(unsigned int), &INDICES[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, GEOMETRY->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GEOMETRY->ebo);
+    setup_vertex_attributes(GEOMETRY->format);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)nullptr);
+    glBindVertexArray(0);
+}
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+const Bounds &Mesh::get_bounds() const
+{
+    return BOUNDS;
+}
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoordinates));
+const Quantization &Mesh::get_quantization() const
+{
+    return GEOMETRY->quantization;
+}
 
-    glBindVertexArray(0);
+GLuint Mesh::get_vao() const
+{
+    return VAO;
 }
 
-void Mesh::draw(Shader &shader) const
+size_t Mesh::get_lod_count() const
 {
-    map<string, int> indices {
-        {"texture_diffuse", 1},
-        {"texture_specular", 1},
-        {"texture_normal", 1},
-        {"texture_height", 1},
-    };
+    return LODS.size();
+}
 
-    for (const Texture& texture : TEXTURES) {
-        glActiveTexture(GL_TEXTURE0 + texture.id - 1);
+const MeshLod &Mesh::get_lod(unsigned int lod) const
+{
+    return LODS[std::min((size_t)lod, LODS.size() - 1)];
+}
 
-        string number = std::to_string(indices[texture.type]++);
-        shader.setUniformInt(texture.type + number, texture.id - 1);
+GLsizei Mesh::get_index_count(unsigned int lod) const
+{
+    return (GLsizei)get_lod(lod).indexCount;
+}
 
-        glBindTexture(GL_TEXTURE_2D, texture.id);
-    }
+const void *Mesh::get_index_offset(unsigned int lod) const
+{
+    size_t indexSize = GEOMETRY->indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+    return (const void *)(get_lod(lod).indexOffset * indexSize);
+}
+
+GLenum Mesh::get_index_type() const
+{
+    return GEOMETRY->indexType;
+}
+
+const Material &Mesh::get_material() const
+{
+    return MATERIAL;
+}
 
-    glActiveTexture(GL_TEXTURE0);
+void Mesh::bind_instance_buffer(unsigned int buffer)
+{
+    INSTANCE_BUFFER = buffer;
 
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, INDICES.size(), GL_UNSIGNED_INT, nullptr);
+    for (unsigned int location = INSTANCE_MODEL_LOCATION; location < INSTANCE_NORMAL_LOCATION + 3; location++) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    FIRST_INSTANCE = -1;
+    set_first_instance(0);
+
     glBindVertexArray(0);
 }
+
+void Mesh::set_first_instance(GLsizei firstInstance) const
+{
+    if (FIRST_INSTANCE == firstInstance) {
+        return;
+    }
+    FIRST_INSTANCE = firstInstance;
+
+    size_t base = (size_t)firstInstance * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, INSTANCE_BUFFER);
+
+    // Matrix attributes occupy one consecutive location per column.
+    for (unsigned int column = 0; column < 4; column++) {
+        glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, model) + sizeof(glm::vec4) * column));
+    }
+
+    for (unsigned int column = 0; column < 3; column++) {
+        glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, normal) + sizeof(glm::vec3) * column));
+    }
+}
+
+void Mesh::apply_quantization(const Shader &shader) const
+{
+    const ObjectUniforms &uniforms = shader.objectUniforms();
+    if (uniforms.positionOffset.valid()) {
+        shader.setUniformVec3(uniforms.positionOffset, GEOMETRY->quantization.offset);
+    }
+    if (uniforms.positionScale.valid()) {
+        shader.setUniformVec3(uniforms.positionScale, GEOMETRY->quantization.scale);
+    }
+}
@@ -3,38 +3,91 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 #include <glad/glad.h>
 #include "../shader/shader.h"
+#include "bounds.h"
+#include "vertex_format.h"
+#include "material.h"
+#include "../render/state_cache.h"
 
 using std::vector;
 using std::string;
+using std::shared_ptr;
 
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 textureCoordinates;
+#define INSTANCE_MODEL_LOCATION 3
+#define INSTANCE_NORMAL_LOCATION 7
+// Detail levels per mesh, the full resolution one included.
+#define MAX_MESH_LODS 4
+
+// Per instance vertex attributes, the model matrix followed by its normal matrix.
+struct InstanceData {
+    glm::mat4 model;
+    glm::mat3 normal;
+};
+
+struct GeometryBuffers;
+
+// Range of one detail level in the shared index buffer.
+struct MeshLod {
+    uint32_t indexOffset, indexCount;
+    // How far, in model units, the level may stray from the full resolution surface.
+    float    error;
 };
 
-struct Texture {
-    unsigned int id;
+struct TextureReference {
     string type;
     string path;
 };
 
+// CPU side geometry produced by the importer, it only lives until it is uploaded and cached.
+struct MeshData {
+    vector<Vertex>           vertices;
+    // Every detail level, finest first, lods holds their ranges. Empty lods is a single level.
+    vector<unsigned int>     indices;
+    vector<MeshLod>          lods;
+    vector<TextureReference> textures;
+    Bounds                   bounds;
+};
+
 class Mesh {
     private:
-        vector<Vertex>       VERTICES;
-        vector<unsigned int> INDICES;
-        vector<Texture>      TEXTURES;
-        unsigned int VAO{}, VBO{}, EBO{};
+        shared_ptr<GeometryBuffers> GEOMETRY;
+        Material                    MATERIAL;
+        Bounds                      BOUNDS;
+        vector<MeshLod>             LODS;
+        unsigned int                VAO{};
+        unsigned int                INSTANCE_BUFFER = 0;
+        mutable GLsizei             FIRST_INSTANCE = 0;
 
         void setup_mesh();
 
     public:
-        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures);
-        void draw(Shader &shader) const;
+        // The VAO is per mesh, the vertex and index buffers may be shared with other meshes.
+        Mesh(shared_ptr<GeometryBuffers> geometry, const vector<MeshLod> &lods, const Material &material, const Bounds &bounds);
+        Mesh(const Mesh&) = delete;
+        Mesh& operator=(const Mesh&) = delete;
+        Mesh(Mesh&&) = default;
+        Mesh& operator=(Mesh&&) = default;
+        const Bounds &get_bounds() const;
+        const Quantization &get_quantization() const;
+        GLuint get_vao() const;
+        size_t get_lod_count() const;
+        // Levels past the coarsest one are clamped to it.
+        const MeshLod &get_lod(unsigned int lod) const;
+        GLsizei get_index_count(unsigned int lod = 0) const;
+        // Byte offset of the level in the element buffer, as passed to glDrawElements.
+        const void *get_index_offset(unsigned int lod = 0) const;
+        GLenum get_index_type() const;
+        const Material &get_material() const;
+        void bind_instance_buffer(unsigned int buffer);
+        // Points the instance attributes of the bound VAO at firstInstance, GL 3.3 has no base instance draws.
+        void set_first_instance(GLsizei firstInstance) const;
+        // Uploads the position decode of this mesh into the shader, which must be in use.
+        void apply_quantization(const Shader &shader) const;
 };
 
 #endif
@@ -0,0 +1,305 @@
+#include "mesh_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include "../util/hash.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define MESH_CACHE_ALIGNMENT 16
+
+struct SourceStamp {
+    int64_t  mtime;
+    uint64_t size;
+};
+
+static bool stamp_source(const string &path, SourceStamp &stamp)
+{
+    struct stat info {};
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+
+    stamp.mtime = (int64_t)info.st_mtime;
+    stamp.size = (uint64_t)info.st_size;
+
+    return true;
+}
+
+static size_t append(vector<unsigned char> &buffer, const void *data, size_t size)
+{
+    size_t offset = (buffer.size() + MESH_CACHE_ALIGNMENT - 1) & ~(size_t)(MESH_CACHE_ALIGNMENT - 1);
+    buffer.resize(offset + size);
+    if (size) {
+        std::memcpy(&buffer[offset], data, size);
+    }
+
+    return offset;
+}
+
+// The entry table follows the header at the first aligned offset, where append() put it.
+static size_t entries_offset()
+{
+    return (sizeof(MeshCacheHeader) + MESH_CACHE_ALIGNMENT - 1) & ~(size_t)(MESH_CACHE_ALIGNMENT - 1);
+}
+
+MeshCache::~MeshCache()
+{
+    close();
+}
+
+string MeshCache::path_for(const string &sourcePath)
+{
+    return sourcePath + ".meshcache";
+}
+
+bool MeshCache::write(const string &sourcePath, const vector<MeshData> &meshes)
+{
+    MeshCacheHeader header {};
+    SourceStamp stamp {};
+    if (!stamp_source(sourcePath, stamp) || !hash_file(sourcePath, header.sourceHash)) {
+        return false;
+    }
+
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.sourceMtime = stamp.mtime;
+    header.sourceSize = stamp.size;
+    header.meshCount = (uint32_t)meshes.size();
+    header.vertexSize = sizeof(Vertex);
+
+    vector<unsigned char> buffer;
+    append(buffer, &header, sizeof(header));
+    size_t entriesOffset = append(buffer, nullptr, meshes.size() * sizeof(MeshCacheEntry));
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const MeshData &mesh = meshes[i];
+
+        MeshCacheEntry entry {};
+        entry.vertexCount = (uint32_t)mesh.vertices.size();
+        entry.indexCount = (uint32_t)mesh.indices.size();
+        entry.textureCount = (uint32_t)mesh.textures.size();
+        entry.vertexOffset = append(buffer, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        entry.indexOffset = append(buffer, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        entry.lodCount = (uint32_t)mesh.lods.size();
+        entry.lodOffset = append(buffer, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+
+        vector<MeshCacheTexture> textures;
+        for (const TextureReference &reference : mesh.textures) {
+            MeshCacheTexture texture {};
+            texture.typeLength = (uint32_t)reference.type.size();
+            texture.pathLength = (uint32_t)reference.path.size();
+            texture.typeOffset = append(buffer, reference.type.data(), reference.type.size());
+            texture.pathOffset = append(buffer, reference.path.data(), reference.path.size());
+            textures.push_back(texture);
+        }
+        entry.textureOffset = append(buffer, textures.data(), textures.size() * sizeof(MeshCacheTexture));
+
+        for (int axis = 0; axis < 3; axis++) {
+            entry.boundsMin[axis] = mesh.bounds.min[axis];
+            entry.boundsMax[axis] = mesh.bounds.max[axis];
+            entry.boundsCenter[axis] = mesh.bounds.center[axis];
+        }
+        entry.boundsRadius = mesh.bounds.radius;
+
+        std::memcpy(&buffer[entriesOffset + i * sizeof(MeshCacheEntry)], &entry, sizeof(entry));
+    }
+
+    // Write next to the target and rename, a crash never leaves a torn cache behind.
+    string path = path_for(sourcePath);
+    string temporaryPath = path + ".tmp";
+
+    FILE *file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    written = fclose(file) == 0 && written;
+
+    std::remove(path.c_str());
+    if (!written || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool MeshCache::map_file(const string &path)
+{
+#ifndef _WIN32
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat info {};
+    if (fstat(descriptor, &info) != 0 || info.st_size < (off_t)sizeof(MeshCacheHeader)) {
+        ::close(descriptor);
+        return false;
+    }
+
+    void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    DATA = static_cast<const unsigned char *>(data);
+    SIZE = (size_t)info.st_size;
+    MAPPED = true;
+#else
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    BUFFER.resize(size > 0 ? (size_t)size : 0);
+    bool read = size >= (long)sizeof(MeshCacheHeader) && fread(BUFFER.data(), 1, BUFFER.size(), file) == BUFFER.size();
+    fclose(file);
+    if (!read) {
+        BUFFER.clear();
+        return false;
+    }
+
+    DATA = BUFFER.data();
+    SIZE = BUFFER.size();
+#endif
+
+    return true;
+}
+
+bool MeshCache::validate(const string &sourcePath) const
+{
+    MeshCacheHeader header {};
+    std::memcpy(&header, DATA, sizeof(header));
+
+    if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION || header.vertexSize != sizeof(Vertex)) {
+        return false;
+    }
+
+    // Reject truncated files before anything points into them.
+    size_t entriesOffset = entries_offset();
+    if (entriesOffset + (uint64_t)header.meshCount * sizeof(MeshCacheEntry) > SIZE) {
+        return false;
+    }
+
+    for (size_t i = 0; i < header.meshCount; i++) {
+        MeshCacheEntry entry {};
+        std::memcpy(&entry, DATA + entriesOffset + i * sizeof(MeshCacheEntry), sizeof(entry));
+
+        if (entry.vertexOffset + (uint64_t)entry.vertexCount * sizeof(Vertex) > SIZE ||
+            entry.indexOffset + (uint64_t)entry.indexCount * sizeof(unsigned int) > SIZE ||
+            entry.lodOffset + (uint64_t)entry.lodCount * sizeof(MeshLod) > SIZE ||
+            entry.textureOffset + (uint64_t)entry.textureCount * sizeof(MeshCacheTexture) > SIZE) {
+            return false;
+        }
+
+        const MeshLod *lods = reinterpret_cast<const MeshLod *>(DATA + entry.lodOffset);
+        for (uint32_t j = 0; j < entry.lodCount; j++) {
+            if ((uint64_t)lods[j].indexOffset + lods[j].indexCount > entry.indexCount) {
+                return false;
+            }
+        }
+
+        const MeshCacheTexture *textures = reinterpret_cast<const MeshCacheTexture *>(DATA + entry.textureOffset);
+        for (uint32_t j = 0; j < entry.textureCount; j++) {
+            if (textures[j].typeOffset + textures[j].typeLength > SIZE || textures[j].pathOffset + textures[j].pathLength > SIZE) {
+                return false;
+            }
+        }
+    }
+
+    SourceStamp stamp {};
+    if (!stamp_source(sourcePath, stamp)) {
+        // Shipped without sources, trust the cache.
+        return true;
+    }
+
+    if (stamp.mtime == header.sourceMtime && stamp.size == header.sourceSize) {
+        return true;
+    }
+
+    // Touched but possibly unchanged (checkouts, copies), fall back to the content hash.
+    uint64_t hash;
+    return stamp.size == header.sourceSize && hash_file(sourcePath, hash) && hash == header.sourceHash;
+}
+
+bool MeshCache::open(const string &sourcePath)
+{
+    close();
+
+    if (!map_file(path_for(sourcePath))) {
+        return false;
+    }
+
+    if (!validate(sourcePath)) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::close()
+{
+#ifndef _WIN32
+    if (MAPPED) {
+        munmap(const_cast<unsigned char *>(DATA), SIZE);
+    }
+#endif
+
+    BUFFER.clear();
+    DATA = nullptr;
+    SIZE = 0;
+    MAPPED = false;
+}
+
+size_t MeshCache::get_mesh_count() const
+{
+    MeshCacheHeader header {};
+    std::memcpy(&header, DATA, sizeof(header));
+
+    return header.meshCount;
+}
+
+MeshView MeshCache::get_mesh(size_t index) const
+{
+    size_t entriesOffset = entries_offset();
+
+    MeshCacheEntry entry {};
+    std::memcpy(&entry, DATA + entriesOffset + index * sizeof(MeshCacheEntry), sizeof(entry));
+
+    MeshView view;
+    view.vertices = reinterpret_cast<const Vertex *>(DATA + entry.vertexOffset);
+    view.indices = reinterpret_cast<const unsigned int *>(DATA + entry.indexOffset);
+    view.vertexCount = entry.vertexCount;
+    view.indexCount = entry.indexCount;
+
+    const MeshLod *lods = reinterpret_cast<const MeshLod *>(DATA + entry.lodOffset);
+    view.lods.assign(lods, lods + entry.lodCount);
+
+    const MeshCacheTexture *textures = reinterpret_cast<const MeshCacheTexture *>(DATA + entry.textureOffset);
+    for (uint32_t i = 0; i < entry.textureCount; i++) {
+        TextureReference reference;
+        reference.type.assign(reinterpret_cast<const char *>(DATA + textures[i].typeOffset), textures[i].typeLength);
+        reference.path.assign(reinterpret_cast<const char *>(DATA + textures[i].pathOffset), textures[i].pathLength);
+        view.textures.push_back(reference);
+    }
+
+    view.bounds.min = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+    view.bounds.max = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+    view.bounds.center = glm::vec3(entry.boundsCenter[0], entry.boundsCenter[1], entry.boundsCenter[2]);
+    view.bounds.radius = entry.boundsRadius;
+
+    return view;
+}
@@ -0,0 +1,80 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+using std::string;
+using std::vector;
+
+// Binary, GPU ready copy of an imported model stored next to its source as
+// <source>.meshcache: a header, one entry per mesh, then 16 byte aligned
+// interleaved vertex, index, detail level and texture reference blobs.
+
+#define MESH_CACHE_MAGIC   0x4D535046u
+#define MESH_CACHE_VERSION 3
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    int64_t  sourceMtime;
+    uint64_t sourceSize;
+    uint32_t meshCount;
+    uint32_t vertexSize;
+};
+
+struct MeshCacheEntry {
+    uint64_t vertexOffset, indexOffset, lodOffset, textureOffset;
+    uint32_t vertexCount, indexCount, lodCount, textureCount;
+    float    boundsMin[3], boundsMax[3], boundsCenter[3], boundsRadius;
+};
+
+static_assert(sizeof(MeshLod) == 12, "MeshLod is stored in the cache as is");
+
+struct MeshCacheTexture {
+    uint64_t typeOffset, pathOffset;
+    uint32_t typeLength, pathLength;
+};
+
+// Points into the mapped cache, valid while the MeshCache stays open.
+struct MeshView {
+    const Vertex             *vertices;
+    const unsigned int       *indices;
+    uint32_t                 vertexCount, indexCount;
+    vector<MeshLod>          lods;
+    vector<TextureReference> textures;
+    Bounds                   bounds;
+};
+
+class MeshCache
+{
+    private:
+        const unsigned char *DATA = nullptr;
+        size_t               SIZE = 0;
+        vector<unsigned char> BUFFER;
+        bool                 MAPPED = false;
+
+        bool map_file(const string &path);
+        bool validate(const string &sourcePath) const;
+
+    public:
+        MeshCache() = default;
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+        ~MeshCache();
+
+        static string path_for(const string &sourcePath);
+        static bool write(const string &sourcePath, const vector<MeshData> &meshes);
+
+        // Maps the cache of sourcePath, fails when it is missing, malformed or older than the source.
+        bool open(const string &sourcePath);
+        void close();
+
+        size_t get_mesh_count() const;
+        MeshView get_mesh(size_t index) const;
+};
+
+#endif
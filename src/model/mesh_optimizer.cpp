@@ -0,0 +1,335 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include "../util/hash.h"
+
+using std::unordered_map;
+
+// Scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+#define FORSYTH_CACHE_SIZE        32
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRIANGLE     0.75f
+#define FORSYTH_VALENCE_SCALE     2.0f
+#define FORSYTH_VALENCE_POWER     0.5f
+
+float average_cache_miss_ratio(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+
+    // A vertex is still cached while fewer than cacheSize misses happened since it was loaded.
+    vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+
+    for (unsigned int index : indices) {
+        if (!loadedAt[index] || misses - loadedAt[index] >= cacheSize) {
+            misses++;
+            loadedAt[index] = misses;
+        }
+    }
+
+    return (float)misses / (float)(indices.size() / 3);
+}
+
+size_t index_size(size_t vertexCount)
+{
+    return vertexCount <= SHORT_INDEX_VERTEX_LIMIT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+static size_t mesh_bytes(const MeshData &mesh)
+{
+    return mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * index_size(mesh.vertices.size());
+}
+
+struct VertexHasher {
+    size_t operator()(const Vertex &vertex) const
+    {
+        return (size_t)hash_bytes(&vertex, sizeof(Vertex));
+    }
+};
+
+struct VertexEqual {
+    bool operator()(const Vertex &left, const Vertex &right) const
+    {
+        return std::memcmp(&left, &right, sizeof(Vertex)) == 0;
+    }
+};
+
+void weld_vertices(MeshData &mesh)
+{
+    unordered_map<Vertex, unsigned int, VertexHasher, VertexEqual> unique;
+    unique.reserve(mesh.vertices.size());
+
+    vector<Vertex> vertices;
+    vector<unsigned int> remap(mesh.vertices.size());
+
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        auto inserted = unique.emplace(mesh.vertices[i], (unsigned int)vertices.size());
+        if (inserted.second) {
+            vertices.push_back(mesh.vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+
+    for (unsigned int &index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+static float forsyth_score(int cachePosition, unsigned int activeTriangles)
+{
+    if (!activeTriangles) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The last triangle's vertices get a fixed score so it is not immediately reused.
+            score = FORSYTH_LAST_TRIANGLE;
+        } else {
+            float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (float)(cachePosition - 3) * scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    return score + FORSYTH_VALENCE_SCALE * std::pow((float)activeTriangles, -FORSYTH_VALENCE_POWER);
+}
+
+void optimize_vertex_cache(MeshData &mesh)
+{
+    size_t triangleCount = mesh.indices.size() / 3;
+    size_t vertexCount = mesh.vertices.size();
+    if (!triangleCount) {
+        return;
+    }
+
+    // Triangles adjacent to each vertex, as offsets into one flat list.
+    vector<unsigned int> activeTriangles(vertexCount, 0);
+    for (unsigned int index : mesh.indices) {
+        activeTriangles[index]++;
+    }
+
+    vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t i = 0; i < vertexCount; i++) {
+        adjacencyOffset[i + 1] = adjacencyOffset[i] + activeTriangles[i];
+    }
+
+    vector<unsigned int> adjacency(mesh.indices.size());
+    vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        adjacency[fill[mesh.indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> vertexScore(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        vertexScore[i] = forsyth_score(-1, activeTriangles[i]);
+    }
+
+    vector<float> triangleScore(triangleCount);
+    vector<bool> emitted(triangleCount, false);
+    for (size_t i = 0; i < triangleCount; i++) {
+        const unsigned int *triangle = &mesh.indices[i * 3];
+        triangleScore[i] = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]];
+    }
+
+    vector<unsigned int> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    vector<unsigned int> result;
+    result.reserve(mesh.indices.size());
+
+    size_t scan = 0;
+    long best = -1;
+
+    while (result.size() < mesh.indices.size()) {
+        if (best < 0) {
+            // Nothing adjacent to the cache is left, restart at the next triangle not emitted yet.
+            while (emitted[scan]) {
+                scan++;
+            }
+            best = (long)scan;
+        }
+
+        const unsigned int *triangle = &mesh.indices[(size_t)best * 3];
+        emitted[(size_t)best] = true;
+
+        nextCache.clear();
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = triangle[corner];
+            result.push_back(vertex);
+            nextCache.push_back(vertex);
+
+            // Remove the emitted triangle from the vertex's active list.
+            unsigned int *begin = &adjacency[adjacencyOffset[vertex]];
+            unsigned int *end = begin + activeTriangles[vertex];
+            std::iter_swap(std::find(begin, end, (unsigned int)best), end - 1);
+            activeTriangles[vertex]--;
+        }
+
+        for (unsigned int vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        for (size_t position = 0; position < nextCache.size(); position++) {
+            cachePosition[nextCache[position]] = position < FORSYTH_CACHE_SIZE ? (int)position : -1;
+        }
+
+        // Only triangles around cached or just evicted vertices changed score.
+        best = -1;
+        float bestScore = -1.0f;
+
+        for (unsigned int vertex : nextCache) {
+            float score = forsyth_score(cachePosition[vertex], activeTriangles[vertex]);
+            float delta = score - vertexScore[vertex];
+            vertexScore[vertex] = score;
+
+            for (unsigned int i = 0; i < activeTriangles[vertex]; i++) {
+                unsigned int adjacent = adjacency[adjacencyOffset[vertex] + i];
+                triangleScore[adjacent] += delta;
+
+                if (triangleScore[adjacent] > bestScore) {
+                    bestScore = triangleScore[adjacent];
+                    best = adjacent;
+                }
+            }
+        }
+
+        if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+
+    mesh.indices.swap(result);
+}
+
+void optimize_overdraw(MeshData &mesh, float threshold)
+{
+    size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    float acmr = average_cache_miss_ratio(mesh.indices, mesh.vertices.size());
+
+    // Split the cache ordered triangles into clusters wherever the FIFO cache starts over.
+    vector<size_t> clusterStart;
+    vector<size_t> loadedAt(mesh.vertices.size(), 0);
+    size_t misses = 0;
+
+    for (size_t i = 0; i < triangleCount; i++) {
+        int triangleMisses = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int index = mesh.indices[i * 3 + corner];
+            if (!loadedAt[index] || misses - loadedAt[index] >= VERTEX_CACHE_SIZE) {
+                misses++;
+                loadedAt[index] = misses;
+                triangleMisses++;
+            }
+        }
+
+        if (i == 0 || triangleMisses == 3) {
+            clusterStart.push_back(i);
+        }
+    }
+    clusterStart.push_back(triangleCount);
+
+    glm::vec3 meshCenter(0.0f);
+    for (const Vertex &vertex : mesh.vertices) {
+        meshCenter += vertex.position;
+    }
+    meshCenter /= (float)mesh.vertices.size();
+
+    // Clusters facing away from the mesh center occlude the rest and go first.
+    size_t clusterCount = clusterStart.size() - 1;
+    vector<float> occlusion(clusterCount);
+    vector<size_t> order(clusterCount);
+
+    for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+
+        for (size_t i = clusterStart[cluster]; i < clusterStart[cluster + 1]; i++) {
+            glm::vec3 a = mesh.vertices[mesh.indices[i * 3]].position;
+            glm::vec3 b = mesh.vertices[mesh.indices[i * 3 + 1]].position;
+            glm::vec3 c = mesh.vertices[mesh.indices[i * 3 + 2]].position;
+
+            glm::vec3 cross = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(cross);
+
+            center += (a + b + c) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        center = area > 0.0f ? center / area : mesh.vertices[mesh.indices[clusterStart[cluster] * 3]].position;
+        normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+
+        occlusion[cluster] = glm::dot(center - meshCenter, normal);
+        order[cluster] = cluster;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&occlusion](size_t left, size_t right) {
+        return occlusion[left] > occlusion[right];
+    });
+
+    vector<unsigned int> result;
+    result.reserve(mesh.indices.size());
+    for (size_t cluster : order) {
+        result.insert(result.end(),
+                      mesh.indices.begin() + clusterStart[cluster] * 3,
+                      mesh.indices.begin() + clusterStart[cluster + 1] * 3);
+    }
+
+    if (average_cache_miss_ratio(result, mesh.vertices.size()) <= acmr * threshold) {
+        mesh.indices.swap(result);
+    }
+}
+
+void optimize_vertex_fetch(MeshData &mesh)
+{
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(mesh.vertices.size(), unused);
+    vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (unsigned int &index : mesh.indices) {
+        if (remap[index] == unused) {
+            remap[index] = (unsigned int)vertices.size();
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    // Vertices no triangle references are dropped here.
+    mesh.vertices.swap(vertices);
+}
+
+MeshOptimizationReport optimize_mesh(MeshData &mesh)
+{
+    MeshOptimizationReport report {};
+    report.vertexCountBefore = mesh.vertices.size();
+    report.acmrBefore = average_cache_miss_ratio(mesh.indices, mesh.vertices.size());
+    // Measured against what was uploaded before, 32 bit indices.
+    report.bytesBefore = mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+
+    weld_vertices(mesh);
+    optimize_vertex_cache(mesh);
+    optimize_overdraw(mesh);
+    optimize_vertex_fetch(mesh);
+
+    report.vertexCountAfter = mesh.vertices.size();
+    report.acmrAfter = average_cache_miss_ratio(mesh.indices, mesh.vertices.size());
+    report.bytesAfter = mesh_bytes(mesh);
+
+    return report;
+}
@@ -0,0 +1,34 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include "mesh.h"
+
+using std::vector;
+
+// FIFO size assumed when measuring post-transform cache efficiency.
+#define VERTEX_CACHE_SIZE 16
+// Largest number of vertices a mesh may have and still be drawn with 16 bit indices.
+#define SHORT_INDEX_VERTEX_LIMIT 65536
+// Overdraw ordering is dropped when it makes the cache ACMR worse than this factor.
+#define OVERDRAW_ACMR_THRESHOLD 1.05f
+
+struct MeshOptimizationReport {
+    size_t vertexCountBefore, vertexCountAfter;
+    float  acmrBefore, acmrAfter;
+    size_t bytesBefore, bytesAfter;
+};
+
+// Average cache miss ratio, transformed vertices per triangle for a FIFO cache.
+float average_cache_miss_ratio(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+size_t index_size(size_t vertexCount);
+
+void weld_vertices(MeshData &mesh);
+void optimize_vertex_cache(MeshData &mesh);
+void optimize_overdraw(MeshData &mesh, float threshold = OVERDRAW_ACMR_THRESHOLD);
+void optimize_vertex_fetch(MeshData &mesh);
+
+// Runs every stage above in order.
+MeshOptimizationReport optimize_mesh(MeshData &mesh);
+
+#endif
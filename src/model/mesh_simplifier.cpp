@@ -0,0 +1,522 @@
+#include "mesh_simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+#include "mesh_optimizer.h"
+
+// A collapse may turn no face further than this from where it faced, it would fold or turn into a sliver.
+#define SIMPLIFY_MIN_NORMAL_COSINE 0.25f
+
+// Sum of squared distances to a set of planes, the upper triangle of the symmetric 4x4 matrix.
+struct Quadric {
+    double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+    double weight;
+};
+
+struct EdgeRecord {
+    // Positions with from < to, and the wedges (vertices) of the triangle at either end.
+    unsigned int from, to;
+    unsigned int wedgeFrom, wedgeTo;
+    unsigned int triangle;
+};
+
+struct Collapse {
+    unsigned int from, to;
+    double       cost;
+    bool         border;
+};
+
+static void add_plane(Quadric &quadric, glm::vec3 normal, float distance, double weight)
+{
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+    quadric.xx += weight * a * a;
+    quadric.xy += weight * a * b;
+    quadric.xz += weight * a * c;
+    quadric.xw += weight * a * d;
+    quadric.yy += weight * b * b;
+    quadric.yz += weight * b * c;
+    quadric.yw += weight * b * d;
+    quadric.zz += weight * c * c;
+    quadric.zw += weight * c * d;
+    quadric.ww += weight * d * d;
+    quadric.weight += weight;
+}
+
+static Quadric sum(const Quadric &left, const Quadric &right)
+{
+    Quadric result;
+    result.xx = left.xx + right.xx;
+    result.xy = left.xy + right.xy;
+    result.xz = left.xz + right.xz;
+    result.xw = left.xw + right.xw;
+    result.yy = left.yy + right.yy;
+    result.yz = left.yz + right.yz;
+    result.yw = left.yw + right.yw;
+    result.zz = left.zz + right.zz;
+    result.zw = left.zw + right.zw;
+    result.ww = left.ww + right.ww;
+    result.weight = left.weight + right.weight;
+
+    return result;
+}
+
+// Mean squared distance of the point to the planes, weighted by area.
+static double quadric_error(const Quadric &quadric, glm::vec3 point)
+{
+    double x = point.x, y = point.y, z = point.z;
+    double error = quadric.xx * x * x + 2.0 * quadric.xy * x * y + 2.0 * quadric.xz * x * z + 2.0 * quadric.xw * x
+                 + quadric.yy * y * y + 2.0 * quadric.yz * y * z + 2.0 * quadric.yw * y
+                 + quadric.zz * z * z + 2.0 * quadric.zw * z
+                 + quadric.ww;
+
+    return quadric.weight > 0.0 ? std::fabs(error) / quadric.weight : 0.0;
+}
+
+// Maps every vertex to the lowest numbered vertex sharing its position, the wedges of one corner.
+static vector<unsigned int> weld_positions(const vector<Vertex> &vertices)
+{
+    vector<unsigned int> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    std::sort(order.begin(), order.end(), [&vertices](unsigned int left, unsigned int right) {
+        const glm::vec3 &a = vertices[left].position, &b = vertices[right].position;
+        if (a.x != b.x) {
+            return a.x < b.x;
+        }
+        if (a.y != b.y) {
+            return a.y < b.y;
+        }
+        if (a.z != b.z) {
+            return a.z < b.z;
+        }
+        return left < right;
+    });
+
+    vector<unsigned int> position(vertices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        bool same = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+        position[order[i]] = same ? position[order[i - 1]] : order[i];
+    }
+
+    return position;
+}
+
+class Simplifier
+{
+    private:
+        const vector<Vertex>       &VERTICES;
+        vector<unsigned int>       &INDICES;
+        vector<unsigned int>       POSITION;
+        vector<Quadric>            QUADRICS;
+        vector<unsigned int>       ADJACENCY_OFFSET, ADJACENCY;
+        vector<unsigned char>      BORDER_EDGES, LOCKED;
+        vector<unsigned int>       MARKS;
+        unsigned int               MARK = 0;
+        vector<std::pair<unsigned int, unsigned int>> WEDGES;
+
+        glm::vec3 position(unsigned int vertex) const
+        {
+            return VERTICES[vertex].position;
+        }
+
+        void add_face_quadrics();
+        void build_adjacency();
+        void classify_edges(vector<Collapse> &collapses, bool addBoundaryQuadrics);
+        bool allow_collapse(unsigned int from, unsigned int to, bool border, Collapse &collapse) const;
+        bool can_collapse(const Collapse &collapse);
+        bool pair_wedges(unsigned int from, unsigned int to);
+        bool link_condition(unsigned int from, unsigned int to, bool border);
+        bool keeps_orientation(unsigned int from, unsigned int to) const;
+        size_t removed_triangles(unsigned int from, unsigned int to) const;
+
+    public:
+        Simplifier(const vector<Vertex> &vertices, vector<unsigned int> &indices);
+
+        // Returns the worst collapse error as a squared distance.
+        double run(size_t targetIndexCount);
+};
+
+Simplifier::Simplifier(const vector<Vertex> &vertices, vector<unsigned int> &indices)
+    : VERTICES(vertices), INDICES(indices)
+{
+    POSITION = weld_positions(vertices);
+    QUADRICS.assign(vertices.size(), Quadric{});
+    MARKS.assign(vertices.size(), 0);
+}
+
+void Simplifier::add_face_quadrics()
+{
+    for (size_t i = 0; i + 2 < INDICES.size(); i += 3) {
+        glm::vec3 a = position(INDICES[i]), b = position(INDICES[i + 1]), c = position(INDICES[i + 2]);
+        glm::vec3 cross = glm::cross(b - a, c - a);
+        float length = glm::length(cross);
+        if (length <= 0.0f) {
+            continue;
+        }
+
+        glm::vec3 normal = cross / length;
+        float distance = -glm::dot(normal, a);
+        for (int corner = 0; corner < 3; corner++) {
+            add_plane(QUADRICS[POSITION[INDICES[i + corner]]], normal, distance, length * 0.5f);
+        }
+    }
+}
+
+void Simplifier::build_adjacency()
+{
+    size_t count = VERTICES.size();
+    ADJACENCY_OFFSET.assign(count + 1, 0);
+    for (unsigned int index : INDICES) {
+        ADJACENCY_OFFSET[POSITION[index] + 1]++;
+    }
+    for (size_t i = 0; i < count; i++) {
+        ADJACENCY_OFFSET[i + 1] += ADJACENCY_OFFSET[i];
+    }
+
+    ADJACENCY.resize(INDICES.size());
+    vector<unsigned int> fill(ADJACENCY_OFFSET.begin(), ADJACENCY_OFFSET.end() - 1);
+    for (size_t i = 0; i < INDICES.size(); i++) {
+        ADJACENCY[fill[POSITION[INDICES[i]]]++] = (unsigned int)(i / 3);
+    }
+}
+
+void Simplifier::classify_edges(vector<Collapse> &collapses, bool addBoundaryQuadrics)
+{
+    vector<EdgeRecord> edges;
+    edges.reserve(INDICES.size());
+
+    for (size_t i = 0; i < INDICES.size(); i++) {
+        unsigned int wedgeA = INDICES[i];
+        unsigned int wedgeB = INDICES[i % 3 == 2 ? i - 2 : i + 1];
+
+        unsigned int triangle = (unsigned int)(i / 3);
+        if (POSITION[wedgeA] < POSITION[wedgeB]) {
+            edges.push_back({POSITION[wedgeA], POSITION[wedgeB], wedgeA, wedgeB, triangle});
+        } else {
+            edges.push_back({POSITION[wedgeB], POSITION[wedgeA], wedgeB, wedgeA, triangle});
+        }
+    }
+
+    std::sort(edges.begin(), edges.end(), [](const EdgeRecord &left, const EdgeRecord &right) {
+        return left.from != right.from ? left.from < right.from : left.to < right.to;
+    });
+
+    BORDER_EDGES.assign(VERTICES.size(), 0);
+    LOCKED.assign(VERTICES.size(), 0);
+
+    size_t first = 0;
+    while (first < edges.size()) {
+        size_t last = first + 1;
+        bool seam = false;
+        while (last < edges.size() && edges[last].from == edges[first].from && edges[last].to == edges[first].to) {
+            seam = seam || edges[last].wedgeFrom != edges[first].wedgeFrom || edges[last].wedgeTo != edges[first].wedgeTo;
+            last++;
+        }
+
+        const EdgeRecord &edge = edges[first];
+        size_t triangles = last - first;
+        bool border = triangles == 1;
+
+        if (triangles > 2) {
+            // Non-manifold, neither end can move without tearing the other faces.
+            LOCKED[edge.from] = LOCKED[edge.to] = 1;
+        }
+        if (border) {
+            BORDER_EDGES[edge.from] = (unsigned char)std::min(BORDER_EDGES[edge.from] + 1, 255);
+            BORDER_EDGES[edge.to] = (unsigned char)std::min(BORDER_EDGES[edge.to] + 1, 255);
+        }
+
+        // Planes through the edge, perpendicular to each face, keep the outline from drifting.
+        if (addBoundaryQuadrics && (border || seam)) {
+            for (size_t i = first; i < last; i++) {
+                const unsigned int *triangle = &INDICES[edges[i].triangle * 3];
+                glm::vec3 a = position(triangle[0]), b = position(triangle[1]), c = position(triangle[2]);
+                glm::vec3 faceNormal = glm::cross(b - a, c - a);
+
+                glm::vec3 from = position(edge.from), to = position(edge.to);
+                glm::vec3 planeNormal = glm::cross(to - from, faceNormal);
+                float length = glm::length(planeNormal);
+                if (length <= 0.0f) {
+                    continue;
+                }
+
+                planeNormal /= length;
+                float distance = -glm::dot(planeNormal, from);
+                double weight = (double)glm::dot(to - from, to - from) * SIMPLIFY_BOUNDARY_WEIGHT;
+                add_plane(QUADRICS[edge.from], planeNormal, distance, weight);
+                add_plane(QUADRICS[edge.to], planeNormal, distance, weight);
+            }
+        }
+
+        collapses.push_back({edge.from, edge.to, 0.0, border});
+        first = last;
+    }
+
+    // Border corners and junctions of several borders stay where they are.
+    for (size_t i = 0; i < VERTICES.size(); i++) {
+        if (BORDER_EDGES[i] && BORDER_EDGES[i] != 2) {
+            LOCKED[i] = 1;
+        }
+    }
+
+    // Pick the cheaper allowed direction of every edge, dropping edges with none.
+    size_t write = 0;
+    for (size_t i = 0; i < collapses.size(); i++) {
+        Collapse forward, backward;
+        bool canForward = allow_collapse(collapses[i].from, collapses[i].to, collapses[i].border, forward);
+        bool canBackward = allow_collapse(collapses[i].to, collapses[i].from, collapses[i].border, backward);
+        if (!canForward && !canBackward) {
+            continue;
+        }
+
+        collapses[write++] = canForward && (!canBackward || forward.cost <= backward.cost) ? forward : backward;
+    }
+    collapses.resize(write);
+}
+
+bool Simplifier::allow_collapse(unsigned int from, unsigned int to, bool border, Collapse &collapse) const
+{
+    // A vertex on a border may only slide along it.
+    if (LOCKED[from] || (BORDER_EDGES[from] && !border)) {
+        return false;
+    }
+
+    collapse = {from, to, quadric_error(sum(QUADRICS[from], QUADRICS[to]), position(to)), border};
+
+    return true;
+}
+
+bool Simplifier::pair_wedges(unsigned int from, unsigned int to)
+{
+    // Every wedge of from has to land on one wedge of to on the same side of any seam, and no two
+    // wedges on the same one, otherwise the collapse would smear attributes across the seam.
+    WEDGES.clear();
+
+    for (unsigned int i = ADJACENCY_OFFSET[from]; i < ADJACENCY_OFFSET[from + 1]; i++) {
+        const unsigned int *triangle = &INDICES[ADJACENCY[i] * 3];
+        unsigned int fromWedge = ~0u, toWedge = ~0u;
+        for (int corner = 0; corner < 3; corner++) {
+            if (POSITION[triangle[corner]] == from) {
+                fromWedge = triangle[corner];
+            } else if (POSITION[triangle[corner]] == to) {
+                toWedge = triangle[corner];
+            }
+        }
+        if (toWedge == ~0u) {
+            continue;
+        }
+
+        bool known = false;
+        for (const std::pair<unsigned int, unsigned int> &pair : WEDGES) {
+            if ((pair.first == fromWedge) != (pair.second == toWedge)) {
+                return false;
+            }
+            known = known || pair.first == fromWedge;
+        }
+        if (!known) {
+            WEDGES.emplace_back(fromWedge, toWedge);
+        }
+    }
+
+    for (unsigned int i = ADJACENCY_OFFSET[from]; i < ADJACENCY_OFFSET[from + 1]; i++) {
+        const unsigned int *triangle = &INDICES[ADJACENCY[i] * 3];
+        for (int corner = 0; corner < 3; corner++) {
+            if (POSITION[triangle[corner]] != from) {
+                continue;
+            }
+
+            bool paired = false;
+            for (const std::pair<unsigned int, unsigned int> &pair : WEDGES) {
+                paired = paired || pair.first == triangle[corner];
+            }
+            if (!paired) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Simplifier::link_condition(unsigned int from, unsigned int to, bool border)
+{
+    // More shared neighbours than the faces of the edge means the collapse folds the surface onto itself.
+    MARK++;
+    for (unsigned int i = ADJACENCY_OFFSET[from]; i < ADJACENCY_OFFSET[from + 1]; i++) {
+        const unsigned int *triangle = &INDICES[ADJACENCY[i] * 3];
+        for (int corner = 0; corner < 3; corner++) {
+            MARKS[POSITION[triangle[corner]]] = MARK;
+        }
+    }
+
+    unsigned int shared = 0;
+    for (unsigned int i = ADJACENCY_OFFSET[to]; i < ADJACENCY_OFFSET[to + 1]; i++) {
+        const unsigned int *triangle = &INDICES[ADJACENCY[i] * 3];
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int neighbour = POSITION[triangle[corner]];
+            if (neighbour != from && neighbour != to && MARKS[neighbour] == MARK) {
+                MARKS[neighbour] = 0;
+                shared++;
+            }
+        }
+    }
+
+    return shared <= (border ? 1u : 2u);
+}
+
+bool Simplifier::keeps_orientation(unsigned int from, unsigned int to) const
+{
+    glm::vec3 target = position(to);
+
+    for (unsigned int i = ADJACENCY_OFFSET[from]; i < ADJACENCY_OFFSET[from + 1]; i++) {
+        const unsigned int *triangle = &INDICES[ADJACENCY[i] * 3];
+        glm::vec3 corners[3], moved[3];
+        bool collapses = false;
+
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertexPosition = POSITION[triangle[corner]];
+            collapses = collapses || vertexPosition == to;
+            corners[corner] = position(triangle[corner]);
+            moved[corner] = vertexPosition == from ? target : corners[corner];
+        }
+        if (collapses) {
+            continue;
+        }
+
+        glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+        if (glm::dot(before, after) <= SIMPLIFY_MIN_NORMAL_COSINE * glm::length(before) * glm::length(after)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t Simplifier::removed_triangles(unsigned int from, unsigned int to) const
+{
+    size_t removed = 0;
+    for (unsigned int i = ADJACENCY_OFFSET[from]; i < ADJACENCY_OFFSET[from + 1]; i++) {
+        const unsigned int *triangle = &INDICES[ADJACENCY[i] * 3];
+        for (int corner = 0; corner < 3; corner++) {
+            removed += POSITION[triangle[corner]] == to;
+        }
+    }
+
+    return removed;
+}
+
+bool Simplifier::can_collapse(const Collapse &collapse)
+{
+    return pair_wedges(collapse.from, collapse.to)
+        && link_condition(collapse.from, collapse.to, collapse.border)
+        && keeps_orientation(collapse.from, collapse.to);
+}
+
+double Simplifier::run(size_t targetIndexCount)
+{
+    add_face_quadrics();
+
+    double worst = 0.0;
+    vector<Collapse> collapses;
+    vector<unsigned int> remap(VERTICES.size());
+    vector<unsigned char> touched(VERTICES.size());
+
+    for (bool first = true; INDICES.size() > targetIndexCount; first = false) {
+        build_adjacency();
+        collapses.clear();
+        classify_edges(collapses, first);
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &left, const Collapse &right) {
+            return left.cost < right.cost;
+        });
+
+        // Collapses within a pass must not share a triangle, the adjacency is rebuilt in between.
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t triangles = INDICES.size() / 3, target = targetIndexCount / 3;
+        unsigned int applied = 0;
+
+        for (const Collapse &collapse : collapses) {
+            if (triangles <= target) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] || !can_collapse(collapse)) {
+                continue;
+            }
+
+            for (const std::pair<unsigned int, unsigned int> &pair : WEDGES) {
+                remap[pair.first] = pair.second;
+            }
+            QUADRICS[collapse.to] = sum(QUADRICS[collapse.to], QUADRICS[collapse.from]);
+            worst = std::max(worst, collapse.cost);
+            triangles -= std::min(triangles, removed_triangles(collapse.from, collapse.to));
+            applied++;
+
+            for (unsigned int i = ADJACENCY_OFFSET[collapse.from]; i < ADJACENCY_OFFSET[collapse.from + 1]; i++) {
+                const unsigned int *triangle = &INDICES[ADJACENCY[i] * 3];
+                for (int corner = 0; corner < 3; corner++) {
+                    touched[POSITION[triangle[corner]]] = 1;
+                }
+            }
+        }
+
+        if (!applied) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i + 2 < INDICES.size(); i += 3) {
+            unsigned int a = remap[INDICES[i]], b = remap[INDICES[i + 1]], c = remap[INDICES[i + 2]];
+            if (POSITION[a] == POSITION[b] || POSITION[b] == POSITION[c] || POSITION[a] == POSITION[c]) {
+                continue;
+            }
+
+            INDICES[write++] = a;
+            INDICES[write++] = b;
+            INDICES[write++] = c;
+        }
+        INDICES.resize(write);
+    }
+
+    return worst;
+}
+
+float simplify_indices(const vector<Vertex> &vertices, const unsigned int *indices, size_t indexCount,
+                       size_t targetIndexCount, vector<unsigned int> &result)
+{
+    result.assign(indices, indices + indexCount);
+
+    Simplifier simplifier(vertices, result);
+    return (float)std::sqrt(simplifier.run(targetIndexCount));
+}
+
+void generate_lods(MeshData &mesh)
+{
+    mesh.lods.clear();
+    mesh.lods.push_back({0, (uint32_t)mesh.indices.size(), 0.0f});
+
+    vector<unsigned int> previous(mesh.indices), simplified;
+    float error = 0.0f;
+
+    while (mesh.lods.size() < MAX_MESH_LODS) {
+        size_t target = (size_t)((float)(previous.size() / 3) * LOD_TRIANGLE_RATIO) * 3;
+        float levelError = simplify_indices(mesh.vertices, previous.data(), previous.size(), target, simplified);
+        if (simplified.empty() || (float)simplified.size() > (float)previous.size() * (1.0f - LOD_MIN_REDUCTION)) {
+            break;
+        }
+
+        // Every level starts from the one before, their errors add up.
+        error += levelError;
+
+        // Reorder the level for the vertex cache, the vertices stay shared with level 0.
+        mesh.indices.swap(simplified);
+        optimize_vertex_cache(mesh);
+        mesh.indices.swap(simplified);
+
+        mesh.lods.push_back({(uint32_t)mesh.indices.size(), (uint32_t)simplified.size(), error});
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include "mesh.h"
+
+using std::vector;
+
+// Every level aims for this fraction of the triangles of the level before it.
+#define LOD_TRIANGLE_RATIO 0.5f
+// A level removing less than this fraction of its parent's triangles ends the chain.
+#define LOD_MIN_REDUCTION 0.1f
+// Weight of the planes holding open borders and UV seams in place, relative to the surface planes.
+#define SIMPLIFY_BOUNDARY_WEIGHT 10.0f
+
+// Collapses edges in order of quadric error until at most targetIndexCount indices are left or no
+// collapse is allowed. Vertices are never moved or added, the result indexes the same vertex buffer.
+// A vertex on a UV seam only collapses along the seam, with every one of its wedges onto a wedge on
+// the same side, and open borders only collapse along themselves. Returns the error of the worst
+// collapse as a distance in model units.
+float simplify_indices(const vector<Vertex> &vertices, const unsigned int *indices, size_t indexCount,
+                       size_t targetIndexCount, vector<unsigned int> &result);
+
+// Appends up to MAX_MESH_LODS - 1 coarser levels to mesh.indices and fills mesh.lods, level 0 is the
+// mesh as it is. Run after optimize_mesh(), the vertex order must not change afterwards.
+void generate_lods(MeshData &mesh);
+
+#endif
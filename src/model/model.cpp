@@ -1,29 +1,164 @@
 #include "model.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
-#include <map>
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "../profile/counters.h"
+#include "normal_matrix.h"
 
-using std::map;
+Model::Model(const char *path, AssetRegistry &assets, VertexFormat format) : Model(read(path), assets, format)
+{
+}
+
+Model::Model(const ModelSource &source, AssetRegistry &assets, VertexFormat format) : ASSETS(assets), FORMAT(format)
+{
+    create_meshes(source);
+}
+
+const Bounds &Model::get_bounds() const
+{
+    return BOUNDS;
+}
+
+const vector<Mesh> &Model::get_meshes() const
+{
+    return MESHES;
+}
+
+GLsizei Model::get_instance_count() const
+{
+    return INSTANCE_COUNT;
+}
+
+unsigned int Model::get_lod_count() const
+{
+    return (unsigned int)LOD_ERRORS.size();
+}
+
+const vector<float> &Model::get_lod_errors() const
+{
+    return LOD_ERRORS;
+}
 
-map<int, int> CHANNEL_COUNT_FORMATS {
-        {1, GL_RED},
-        {3, GL_RGB},
-        {4, GL_RGBA}
-};
+GLsizei Model::get_lod_instance_count(unsigned int lod) const
+{
+    return lod < MAX_MESH_LODS ? LOD_INSTANCES[lod] : 0;
+}
+
+void Model::set_instances(const glm::mat4 *transforms, GLsizei count, const GLsizei *lodCounts)
+{
+    if (!INSTANCE_VBO) {
+        glGenBuffers(1, &INSTANCE_VBO);
+        for (Mesh& mesh : MESHES) {
+            mesh.bind_instance_buffer(INSTANCE_VBO);
+        }
+    }
+
+    INSTANCE_COUNT = count;
+    for (unsigned int lod = 0; lod < MAX_MESH_LODS; lod++) {
+        LOD_INSTANCES[lod] = lodCounts ? (lod < get_lod_count() ? lodCounts[lod] : 0) : (lod ? 0 : count);
+    }
+    if (!INSTANCE_COUNT) {
+        return;
+    }
 
-Model::Model(const char *path)
+    // Only grows, so a steady instance count never reallocates.
+    if ((size_t)INSTANCE_COUNT > INSTANCES.size()) {
+        INSTANCES.resize((size_t)INSTANCE_COUNT);
+        INSTANCE_NORMALS.resize((size_t)INSTANCE_COUNT);
+    }
+
+    normal_matrices(transforms, INSTANCE_NORMALS.data(), (size_t)INSTANCE_COUNT);
+    for (GLsizei i = 0; i < INSTANCE_COUNT; i++) {
+        INSTANCES[i].model = transforms[i];
+        INSTANCES[i].normal = INSTANCE_NORMALS[i];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, INSTANCE_VBO);
+    Counters::add(Counter::BUFFER_BYTES_UPLOADED, INSTANCE_COUNT * sizeof(InstanceData));
+    if (INSTANCE_COUNT > INSTANCE_CAPACITY) {
+        INSTANCE_CAPACITY = INSTANCE_COUNT;
+        glBufferData(GL_ARRAY_BUFFER, INSTANCE_CAPACITY * sizeof(InstanceData), INSTANCES.data(), GL_DYNAMIC_DRAW);
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, INSTANCE_COUNT * sizeof(InstanceData), INSTANCES.data());
+    }
+}
+
+ModelSource Model::read(const string& path)
 {
-    load_model(path);
+    ModelSource source;
+    source.directory = path.substr(0, path.find_last_of('/'));
+
+    std::unique_ptr<MeshCache> cache(new MeshCache());
+    if (cache->open(path)) {
+        source.cache = std::move(cache);
+
+        return source;
+    }
+
+    if (!import_model(path, source.meshes)) {
+        return source;
+    }
+
+    // Optimized and simplified once here, the cache stores the result.
+    for (size_t i = 0; i < source.meshes.size(); i++) {
+        MeshData &mesh = source.meshes[i];
+        MeshOptimizationReport report = optimize_mesh(mesh);
+        fprintf(stdout, "Optimized mesh %zu of %s: %zu -> %zu vertices, ACMR %.3f -> %.3f, %zu -> %zu bytes.\n",
+                i, path.c_str(), report.vertexCountBefore, report.vertexCountAfter,
+                report.acmrBefore, report.acmrAfter, report.bytesBefore, report.bytesAfter);
+
+        generate_lods(mesh);
+        fprintf(stdout, "Generated %zu detail levels for mesh %zu of %s:", mesh.lods.size(), i, path.c_str());
+        for (const MeshLod &lod : mesh.lods) {
+            fprintf(stdout, " %u triangles (error %g)", lod.indexCount / 3, lod.error);
+        }
+        fprintf(stdout, ".\n");
+    }
+
+    if (!MeshCache::write(path, source.meshes)) {
+        fprintf(stderr, "Failed to write mesh cache for %s.\n", path.c_str());
+    }
+
+    return source;
 }
 
-void Model::draw(Shader &shader)
+void Model::create_meshes(const ModelSource &source)
 {
+    DIRECTORY = source.directory;
+
+    if (source.cache) {
+        for (size_t i = 0; i < source.cache->get_mesh_count(); i++) {
+            MeshView mesh = source.cache->get_mesh(i);
+            create_mesh(mesh.vertices, mesh.vertexCount, mesh.indices, mesh.indexCount, mesh.lods, mesh.textures, mesh.bounds);
+        }
+    } else {
+        for (const MeshData& mesh : source.meshes) {
+            create_mesh(mesh.vertices.data(), (GLsizei)mesh.vertices.size(), mesh.indices.data(), (GLsizei)mesh.indices.size(),
+                        mesh.lods, mesh.textures, mesh.bounds);
+        }
+    }
+
+    for (const Mesh& mesh : MESHES) {
+        BOUNDS.add(mesh.get_bounds());
+    }
+    BOUNDS.finish();
     for (const Mesh& mesh : MESHES) {
-        mesh.draw(shader);
+        BOUNDS.fit_sphere(mesh.get_bounds());
+    }
+
+    // A level of the model is the same level of every mesh, or the coarsest one a mesh has.
+    size_t lodCount = 1;
+    for (const Mesh& mesh : MESHES) {
+        lodCount = std::max(lodCount, mesh.get_lod_count());
+    }
+    LOD_ERRORS.assign(lodCount, 0.0f);
+    for (unsigned int lod = 0; lod < lodCount; lod++) {
+        for (const Mesh& mesh : MESHES) {
+            LOD_ERRORS[lod] = std::max(LOD_ERRORS[lod], mesh.get_lod(lod).error / std::max(BOUNDS.radius, FLT_MIN));
+        }
     }
 }
 
-void Model::load_model(const string& path)
+bool Model::import_model(const string& path, vector<MeshData> &meshes)
 {
     Assimp::Importer importer;
     const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate);
@@ -31,33 +166,37 @@ void Model::load_model(const string& path)
     if (!scene || !scene->mRootNode || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) {
         fprintf(stderr, "%s", importer.GetErrorString());
 
-        return;
+        return false;
     }
 
-    DIRECTORY = path.substr(0, path.find_last_of('/'));
+    process_node(scene->mRootNode, scene, meshes);
 
-    process_node(scene->mRootNode, scene);
+    return true;
 }
 
-void Model::process_node(aiNode *node, const aiScene *scene)
+void Model::process_node(aiNode *node, const aiScene *scene, vector<MeshData> &meshes)
 {
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        MESHES.push_back(process_mesh(mesh, scene));
+        meshes.push_back(process_mesh(mesh, scene));
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        process_node(node->mChildren[i], scene);
+        process_node(node->mChildren[i], scene, meshes);
     }
 }
 
-Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
+MeshData Model::process_mesh(aiMesh *mesh, const aiScene *scene)
 {
-    vector<Vertex> vertices;
-    vector<unsigned int> indices;
-    vector<Texture> textures;
+    MeshData data;
+    vector<Vertex> &vertices = data.vertices;
+    vector<unsigned int> &indices = data.indices;
+    Bounds &bounds = data.bounds;
+
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(mesh->mNumFaces * 3);
 
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
         Vertex vertex{};
@@ -84,6 +223,12 @@ Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
         }
 
         vertices.push_back(vertex);
+        bounds.add(vertex.position);
+    }
+
+    bounds.finish();
+    for (const Vertex& vertex : vertices) {
+        bounds.fit_sphere(vertex.position);
     }
 
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
@@ -96,82 +241,69 @@ Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
 
     if (mesh->mMaterialIndex >= 0)
     {
-        aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-
-        vector<Texture> diffuseMaps = load_material_textures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        aiMaterial *sceneMaterial = scene->mMaterials[mesh->mMaterialIndex];
 
-        vector<Texture> specularMaps = load_material_textures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        collect_textures(sceneMaterial, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
+        collect_textures(sceneMaterial, aiTextureType_SPECULAR, "texture_specular", data.textures);
     }
 
-    return {vertices, indices, textures};
+    return data;
 }
 
-vector<Texture> Model::load_material_textures(aiMaterial *material, aiTextureType type, const string& typeName)
+void Model::collect_textures(aiMaterial *sceneMaterial, aiTextureType type, const string& typeName, vector<TextureReference> &textures)
 {
-    vector<Texture> textures;
-
-    for (unsigned int i = 0; i < material->GetTextureCount(type); i++) {
+    for (unsigned int i = 0; i < sceneMaterial->GetTextureCount(type); i++) {
         aiString path;
-        material->GetTexture(type, i, &path);
-
-        bool skip = false;
-        for (Texture &texture : LOADED_TEXTURES) {
-            if (std::strcmp(texture.path.data(), path.C_Str()) == 0) {
-                textures.push_back(texture);
-                skip = true;
-                break;
-            }
-        }
-
-        if (skip) {
-            continue;
-        }
+        sceneMaterial->GetTexture(type, i, &path);
 
-        Texture texture;
-        texture.id = texture_from_file(path.C_Str(), DIRECTORY);
-        texture.type = typeName;
-        texture.path = path.C_Str();
-        textures.push_back(texture);
-        LOADED_TEXTURES.push_back(texture);
-        fprintf(stdout, "Loaded %s with id %d\n", path.C_Str(), texture.id);
+        textures.push_back({typeName, path.C_Str()});
     }
-    return textures;
 }
 
-unsigned int Model::texture_from_file(const char *path, const string &directory)
+void Model::create_mesh(const Vertex *vertices, GLsizei vertexCount, const unsigned int *indices, GLsizei indexCount,
+                        const vector<MeshLod> &lods, const vector<TextureReference> &textures, const Bounds &bounds)
 {
-    string filename = string(path);
-    filename = directory + '/' + filename;
+    shared_ptr<GeometryBuffers> geometry;
 
-    unsigned int texture;
-    glGenTextures(1, &texture);
+    if (FORMAT == VertexFormat::COMPACT) {
+        VertexError error {};
+        Quantization quantization = quantization_for(bounds);
+        vector<CompactVertex> compact = compress_vertices(vertices, vertexCount, quantization, error);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        fprintf(stdout, "Compacted %d vertices in %s from %d to %d bytes, max error: position %g, normal %.2f deg, uv %g.\n",
+                vertexCount, DIRECTORY.c_str(), vertexCount * vertex_size(VertexFormat::FLOAT),
+                vertexCount * vertex_size(VertexFormat::COMPACT), error.position, error.normalDegrees,
+                error.textureCoordinates);
 
-    stbi_set_flip_vertically_on_load(true);
-
-    int textureWidth, textureHeight, channelCount;
-    unsigned char *data = stbi_load(filename.c_str(), &textureWidth, &textureHeight, &channelCount, 0);
-    if (!data) {
-        fprintf(stderr, "Failed to load texture.");
-        stbi_image_free(data);
+        geometry = ASSETS.get_geometry(compact.data(), vertexCount, FORMAT, quantization, indices, indexCount);
+    } else {
+        geometry = ASSETS.get_geometry(vertices, vertexCount, FORMAT, Quantization(), indices, indexCount);
+    }
 
-        return texture;
+    // Meshes without detail levels are a single level over all of their indices.
+    vector<MeshLod> levels = lods;
+    if (levels.empty()) {
+        levels.push_back({0, (uint32_t)indexCount, 0.0f});
     }
 
-    GLint format = CHANNEL_COUNT_FORMATS[channelCount];
+    MESHES.emplace_back(geometry, levels, load_material_textures(textures), bounds);
+}
+
+Material Model::load_material_textures(const vector<TextureReference> &textures)
+{
+    Material material;
 
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, textureWidth, textureHeight, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    for (const TextureReference &reference : textures) {
+        shared_ptr<TextureAsset> texture = ASSETS.get_texture(DIRECTORY + '/' + reference.path);
+        if (!texture) {
+            continue;
+        }
+        TEXTURES.push_back(texture);
 
-    stbi_image_free(data);
+        if (!material.add_texture(reference.type, texture->id)) {
+            fprintf(stderr, "Material has no free %s unit for %s.\n", reference.type.c_str(), reference.path.c_str());
+        }
+    }
 
-    return texture;
+    return material;
 }
-
@@ -10,25 +10,61 @@
 #include <assimp/postprocess.h>
 #include "../shader/shader.h"
 #include "mesh.h"
+#include "asset_registry.h"
+#include "mesh_cache.h"
 
 using std::vector;
 using std::string;
 
+// Everything Model needs from disk, produced off the GL thread by Model::read.
+struct ModelSource {
+    string                directory;
+    vector<MeshData>      meshes;
+    std::unique_ptr<MeshCache> cache;
+};
+
 class Model
 {
     private:
         vector<Mesh>    MESHES;
-        vector<Texture> LOADED_TEXTURES;
+        AssetRegistry                    &ASSETS;
+        VertexFormat                     FORMAT;
+        vector<shared_ptr<TextureAsset>> TEXTURES;
         string          DIRECTORY;
+        Bounds          BOUNDS;
+        // Worst error of every detail level over the meshes, relative to the bounding radius.
+        vector<float>   LOD_ERRORS;
+        vector<InstanceData> INSTANCES;
+        vector<glm::mat3>    INSTANCE_NORMALS;
+        unsigned int    INSTANCE_VBO = 0;
+        GLsizei         INSTANCE_COUNT = 0,
+                        INSTANCE_CAPACITY = 0;
+        GLsizei         LOD_INSTANCES[MAX_MESH_LODS] {};
 
-        void load_model(const string& path);
-        void process_node(aiNode *node, const aiScene *scene);
-        Mesh process_mesh(aiMesh *mesh, const aiScene *scene);
-        vector<Texture> load_material_textures(aiMaterial *mat, aiTextureType type, const string& typeName);
-        static unsigned int texture_from_file(const char *path, const string &directory);
+        void create_meshes(const ModelSource &source);
+        static bool import_model(const string& path, vector<MeshData> &meshes);
+        static void process_node(aiNode *node, const aiScene *scene, vector<MeshData> &meshes);
+        static MeshData process_mesh(aiMesh *mesh, const aiScene *scene);
+        static void collect_textures(aiMaterial *mat, aiTextureType type, const string& typeName, vector<TextureReference> &textures);
+        void create_mesh(const Vertex *vertices, GLsizei vertexCount, const unsigned int *indices, GLsizei indexCount,
+                         const vector<MeshLod> &lods, const vector<TextureReference> &textures, const Bounds &bounds);
+        Material load_material_textures(const vector<TextureReference> &textures);
     public:
-        explicit Model(const char *path);
-        void draw(Shader &shader);
+        Model(const char *path, AssetRegistry &assets, VertexFormat format = VertexFormat::FLOAT);
+        Model(const ModelSource &source, AssetRegistry &assets, VertexFormat format = VertexFormat::FLOAT);
+        // Thread safe, maps the mesh cache or imports and caches the source.
+        static ModelSource read(const string& path);
+        Model(const Model&) = delete;
+        Model& operator=(const Model&) = delete;
+        const Bounds &get_bounds() const;
+        const vector<Mesh> &get_meshes() const;
+        GLsizei get_instance_count() const;
+        unsigned int get_lod_count() const;
+        const vector<float> &get_lod_errors() const;
+        // Instances of the level, they follow the instances of every finer level in the buffer.
+        GLsizei get_lod_instance_count(unsigned int lod) const;
+        // lodCounts splits the transforms, sorted by level, into get_lod_count() runs. Null draws every one at level 0.
+        void set_instances(const glm::mat4 *transforms, GLsizei count, const GLsizei *lodCounts = nullptr);
 };
 
 #endif
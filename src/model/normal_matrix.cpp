@@ -0,0 +1,53 @@
+#include "normal_matrix.h"
+#include <cmath>
+
+static glm::mat3 cofactor(const glm::mat3 &matrix)
+{
+    glm::mat3 result(
+        glm::cross(matrix[1], matrix[2]),
+        glm::cross(matrix[2], matrix[0]),
+        glm::cross(matrix[0], matrix[1])
+    );
+
+    // A mirroring transform has a negative determinant, keep the normals facing out.
+    float determinant = glm::dot(matrix[0], result[0]);
+
+    return determinant < 0.0f ? -result : result;
+}
+
+glm::mat3 normal_matrix(const glm::mat4 &model)
+{
+    glm::mat3 matrix(model);
+
+    float x = glm::dot(matrix[0], matrix[0]);
+    float y = glm::dot(matrix[1], matrix[1]);
+    float z = glm::dot(matrix[2], matrix[2]);
+    float tolerance = UNIFORM_SCALE_EPSILON * x;
+
+    bool uniform = std::fabs(x - y) <= tolerance && std::fabs(x - z) <= tolerance;
+    // Equal lengths alone also pass a shear, the axes have to be perpendicular as well.
+    bool orthogonal = std::fabs(glm::dot(matrix[0], matrix[1])) <= tolerance &&
+                      std::fabs(glm::dot(matrix[1], matrix[2])) <= tolerance &&
+                      std::fabs(glm::dot(matrix[2], matrix[0])) <= tolerance;
+
+    // Mirroring transforms take the cofactor path, so they get the same sign correction as normal_matrices().
+    if (uniform && orthogonal && glm::dot(matrix[0], glm::cross(matrix[1], matrix[2])) > 0.0f) {
+        return matrix;
+    }
+
+    return cofactor(matrix);
+}
+
+void normal_matrices(const glm::mat4 *models, glm::mat3 *normals, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec3 a(models[i][0]), b(models[i][1]), c(models[i][2]);
+
+        glm::vec3 x = glm::cross(b, c);
+        glm::vec3 y = glm::cross(c, a);
+        glm::vec3 z = glm::cross(a, b);
+        float sign = glm::dot(a, x) < 0.0f ? -1.0f : 1.0f;
+
+        normals[i] = glm::mat3(x * sign, y * sign, z * sign);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef NORMAL_MATRIX_H
+#define NORMAL_MATRIX_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Relative difference between squared axis lengths, and relative dot product between axes,
+// still treated as a rotation with uniform scale.
+#define UNIFORM_SCALE_EPSILON 1e-4f
+
+// Transforms normals of a model matrix up to a positive scale, shaders normalize afterwards.
+// Rotation with uniform scale uses the upper 3x3 directly, anything else, mirroring included, its cofactor matrix,
+// which is the inverse transpose without the division by the determinant.
+glm::mat3 normal_matrix(const glm::mat4 &model);
+
+// Branch free cofactor version of normal_matrix over a batch, written for the compiler to vectorize.
+void normal_matrices(const glm::mat4 *models, glm::mat3 *normals, size_t count);
+
+#endif
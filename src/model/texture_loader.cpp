@@ -0,0 +1,235 @@
+#include "texture_loader.h"
+#include "../profile/counters.h"
+#include "../shader/texture_units.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+
+using std::map;
+
+static const map<int, GLint> CHANNEL_COUNT_FORMATS {
+        {1, GL_RED},
+        {3, GL_RGB},
+        {4, GL_RGBA}
+};
+
+static const unsigned char PLACEHOLDER_TEXEL[4] {128, 128, 128, 255};
+
+TextureLoader::TextureLoader(ThreadPool &pool) : POOL(pool)
+{
+    // Global stb state, set once here before any worker decodes.
+    stbi_set_flip_vertically_on_load(true);
+}
+
+TextureLoader::~TextureLoader()
+{
+    for (PendingTexture &entry : PENDING) {
+        if (entry.image.valid()) {
+            stbi_image_free(entry.image.get().pixels);
+        }
+        stbi_image_free(entry.decoded.pixels);
+        if (entry.fence) {
+            glDeleteSync(entry.fence);
+        }
+        if (entry.pbo) {
+            glDeleteBuffers(1, &entry.pbo);
+        }
+    }
+}
+
+DecodedImage TextureLoader::decode(const string &path)
+{
+    DecodedImage image;
+    image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+
+    return image;
+}
+
+// Leaves the upload unit active, callers switch back to unit 0 when done.
+void TextureLoader::bind(GLuint texture)
+{
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UPLOAD_UNIT);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    Counters::add(Counter::TEXTURE_BINDS);
+}
+
+GLuint TextureLoader::load(const string &path)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    bind(texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_TEXEL);
+    glActiveTexture(GL_TEXTURE0);
+    Counters::add(Counter::TEXTURE_BYTES_RESIDENT, sizeof(PLACEHOLDER_TEXEL));
+
+    PendingTexture entry;
+    entry.texture = texture;
+    entry.path = path;
+    entry.image = POOL.submit([path]() { return decode(path); });
+    PENDING.push_back(std::move(entry));
+
+    return texture;
+}
+
+bool TextureLoader::begin(PendingTexture &entry)
+{
+    DecodedImage image = entry.image.get();
+
+    auto format = CHANNEL_COUNT_FORMATS.find(image.channels);
+    if (!image.pixels || format == CHANNEL_COUNT_FORMATS.end()) {
+        fprintf(stderr, "Failed to load texture %s.\n", entry.path.c_str());
+        stbi_image_free(image.pixels);
+
+        return false;
+    }
+
+    entry.decoded = image;
+    entry.format = format->second;
+    entry.size = (GLsizeiptr)image.width * image.height * image.channels;
+
+    glGenBuffers(1, &entry.pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, entry.pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, entry.size, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    entry.stage = Stage::STAGING;
+
+    return true;
+}
+
+size_t TextureLoader::stage_pixels(PendingTexture &entry, size_t budget)
+{
+    GLsizeiptr chunk = (GLsizeiptr)std::min((size_t)(entry.size - entry.staged), budget);
+
+    // The GPU has not touched the buffer yet, the written ranges never need to wait on it.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, entry.pbo);
+    void *destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, entry.staged, chunk,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (destination) {
+        std::memcpy(destination, entry.decoded.pixels + entry.staged, (size_t)chunk);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        glBufferSubData(GL_PIXEL_UNPACK_BUFFER, entry.staged, chunk, entry.decoded.pixels + entry.staged);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    entry.staged += chunk;
+    Counters::add(Counter::BUFFER_BYTES_UPLOADED, (uint64_t)chunk);
+
+    if (entry.staged == entry.size) {
+        stbi_image_free(entry.decoded.pixels);
+        entry.decoded.pixels = nullptr;
+        entry.stage = Stage::UPLOADING;
+    }
+
+    return (size_t)chunk;
+}
+
+void TextureLoader::upload(PendingTexture &entry)
+{
+    // Sourced from the bound unpack buffer, the copy into the texture happens on the GPU timeline.
+    // Only level 0 is sampled until the fence shows it has arrived and the mips can be built.
+    bind(entry.texture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, entry.pbo);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, entry.format, entry.decoded.width, entry.decoded.height, 0, entry.format,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    entry.stage = Stage::MIPMAPPING;
+
+    // The placeholder is gone.
+    Counters::add(Counter::TEXTURE_BYTES_RESIDENT, (uint64_t)entry.size - sizeof(PLACEHOLDER_TEXEL));
+}
+
+bool TextureLoader::finish_mipmaps(PendingTexture &entry, bool wait)
+{
+    GLenum status = glClientWaitSync(entry.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+
+    bind(entry.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glActiveTexture(GL_TEXTURE0);
+
+    // The PBO can only go once the GPU has consumed it.
+    glDeleteSync(entry.fence);
+    glDeleteBuffers(1, &entry.pbo);
+
+    // The mip chain adds about a third.
+    Counters::add(Counter::TEXTURE_BYTES_RESIDENT, (uint64_t)(entry.size / 3));
+
+    return true;
+}
+
+void TextureLoader::process(size_t budget, bool wait)
+{
+    size_t uploaded = 0;
+
+    for (size_t i = 0; i < PENDING.size();) {
+        PendingTexture &entry = PENDING[i];
+
+        switch (entry.stage) {
+            case Stage::DECODING: {
+                bool ready = wait || entry.image.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                if (uploaded >= budget || !ready) {
+                    break;
+                }
+                if (!begin(entry)) {
+                    PENDING.erase(PENDING.begin() + i);
+                    continue;
+                }
+                uploaded += stage_pixels(entry, budget - uploaded);
+                break;
+            }
+            case Stage::STAGING:
+                if (uploaded < budget) {
+                    uploaded += stage_pixels(entry, budget - uploaded);
+                }
+                break;
+            case Stage::UPLOADING:
+                upload(entry);
+                break;
+            case Stage::MIPMAPPING:
+                if (finish_mipmaps(entry, wait)) {
+                    PENDING.erase(PENDING.begin() + i);
+                    continue;
+                }
+                break;
+        }
+
+        i++;
+    }
+}
+
+void TextureLoader::update()
+{
+    if (!PENDING.empty()) {
+        process(TEXTURE_UPLOAD_BUDGET, false);
+    }
+}
+
+void TextureLoader::finish()
+{
+    while (!PENDING.empty()) {
+        process(std::numeric_limits<size_t>::max(), true);
+    }
+}
+
+size_t TextureLoader::get_pending_count() const
+{
+    return PENDING.size();
+}
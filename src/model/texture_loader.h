@@ -0,0 +1,80 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <future>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "../util/thread_pool.h"
+
+using std::string;
+using std::vector;
+
+// Bytes of decoded pixels copied into pixel buffers per update, large images are split over
+// several frames so late arrivals never hitch one.
+#define TEXTURE_UPLOAD_BUDGET (1024 * 1024)
+
+struct DecodedImage {
+    unsigned char *pixels = nullptr;
+    int width = 0,
+        height = 0,
+        channels = 0;
+};
+
+// Hands out texture names immediately, backed by a 1x1 placeholder until a worker has decoded
+// the file and update() has streamed it into the same name through a pixel buffer object.
+// Every update() moves a texture at most one stage on: the decoded pixels are copied into the
+// buffer in budgeted chunks, the next frame sources the texture from it, and the mip chain is
+// only built once a fence shows the GPU has finished that transfer.
+class TextureLoader
+{
+    private:
+        enum class Stage {
+            DECODING,
+            STAGING,
+            UPLOADING,
+            MIPMAPPING,
+        };
+
+        struct PendingTexture {
+            GLuint                    texture;
+            string                    path;
+            std::future<DecodedImage> image;
+            Stage                     stage = Stage::DECODING;
+            DecodedImage              decoded;
+            GLint                     format = GL_RGBA;
+            GLsizeiptr                size = 0,
+                                      staged = 0;
+            GLuint                    pbo = 0;
+            GLsync                    fence = nullptr;
+        };
+
+        ThreadPool             &POOL;
+        vector<PendingTexture> PENDING;
+
+        static DecodedImage decode(const string &path);
+        static void bind(GLuint texture);
+        // Takes the decoded image and allocates its pixel buffer, false when it failed to decode.
+        bool begin(PendingTexture &entry);
+        // Copies up to budget bytes into the pixel buffer, returns the bytes copied.
+        size_t stage_pixels(PendingTexture &entry, size_t budget);
+        void upload(PendingTexture &entry);
+        // Returns true once the transfer has completed and the mip chain is built.
+        bool finish_mipmaps(PendingTexture &entry, bool wait);
+        void process(size_t budget, bool wait);
+
+    public:
+        explicit TextureLoader(ThreadPool &pool);
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+        ~TextureLoader();
+
+        GLuint load(const string &path);
+        // Call once per frame on the GL thread.
+        void update();
+        // Blocks until every requested texture is resident.
+        void finish();
+        size_t get_pending_count() const;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "vertex_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/gtc/packing.hpp>
+
+#define POSITION_STEPS  65535.0f
+#define NORMAL_STEPS    511.0f
+
+GLsizei vertex_size(VertexFormat format)
+{
+    return format == VertexFormat::COMPACT ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+void setup_vertex_attributes(VertexFormat format)
+{
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    if (format == VertexFormat::COMPACT) {
+        GLsizei stride = sizeof(CompactVertex);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, position));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(CompactVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, textureCoordinates));
+
+        return;
+    }
+
+    GLsizei stride = sizeof(Vertex);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, position));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, normal));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, textureCoordinates));
+}
+
+Quantization quantization_for(const Bounds &bounds)
+{
+    Quantization quantization;
+    if (bounds.empty()) {
+        return quantization;
+    }
+
+    quantization.offset = bounds.min;
+    // A flat axis still needs a non zero scale, every vertex sits on the offset anyway.
+    quantization.scale = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+
+    return quantization;
+}
+
+static uint32_t pack_snorm10(float value)
+{
+    int component = (int)std::round(glm::clamp(value, -1.0f, 1.0f) * NORMAL_STEPS);
+
+    return (uint32_t)component & 0x3FFu;
+}
+
+static float unpack_snorm10(uint32_t bits)
+{
+    // Sign extend the 10 bit field.
+    int component = (int)(bits << 22) >> 22;
+
+    return std::max((float)component / NORMAL_STEPS, -1.0f);
+}
+
+vector<CompactVertex> compress_vertices(const Vertex *vertices, GLsizei count, const Quantization &quantization,
+                                        VertexError &error)
+{
+    vector<CompactVertex> compact((size_t)count);
+    error = {};
+
+    float minimumCosine = 1.0f;
+
+    for (GLsizei i = 0; i < count; i++) {
+        const Vertex &vertex = vertices[i];
+        CompactVertex &packed = compact[(size_t)i];
+
+        glm::vec3 position;
+        for (int axis = 0; axis < 3; axis++) {
+            float normalized = (vertex.position[axis] - quantization.offset[axis]) / quantization.scale[axis];
+            packed.position[axis] = (uint16_t)std::round(glm::clamp(normalized, 0.0f, 1.0f) * POSITION_STEPS);
+            position[axis] = quantization.offset[axis] + packed.position[axis] / POSITION_STEPS * quantization.scale[axis];
+        }
+        packed.position[3] = 0;
+
+        glm::vec3 normal = glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+        packed.normal = pack_snorm10(normal.x) | pack_snorm10(normal.y) << 10 | pack_snorm10(normal.z) << 20;
+        glm::vec3 decodedNormal(
+            unpack_snorm10(packed.normal),
+            unpack_snorm10(packed.normal >> 10),
+            unpack_snorm10(packed.normal >> 20)
+        );
+
+        packed.textureCoordinates[0] = glm::packHalf1x16(vertex.textureCoordinates.x);
+        packed.textureCoordinates[1] = glm::packHalf1x16(vertex.textureCoordinates.y);
+        glm::vec2 textureCoordinates(
+            glm::unpackHalf1x16(packed.textureCoordinates[0]),
+            glm::unpackHalf1x16(packed.textureCoordinates[1])
+        );
+
+        glm::vec3 positionError = glm::abs(position - vertex.position);
+        glm::vec2 textureError = glm::abs(textureCoordinates - vertex.textureCoordinates);
+        error.position = std::max(error.position, std::max(positionError.x, std::max(positionError.y, positionError.z)));
+        error.textureCoordinates = std::max(error.textureCoordinates, std::max(textureError.x, textureError.y));
+        minimumCosine = std::min(minimumCosine, glm::dot(normal, glm::normalize(decodedNormal)));
+    }
+
+    error.normalDegrees = glm::degrees(std::acos(glm::clamp(minimumCosine, -1.0f, 1.0f)));
+
+    return compact;
+}
@@ -0,0 +1,52 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "bounds.h"
+
+using std::vector;
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 textureCoordinates;
+};
+
+enum class VertexFormat {
+    FLOAT,
+    // 16 bit positions inside the mesh AABB, 10-10-10-2 normals and half float UVs.
+    COMPACT
+};
+
+struct CompactVertex {
+    uint16_t position[4];
+    uint32_t normal;
+    uint16_t textureCoordinates[2];
+};
+
+static_assert(sizeof(Vertex) == 32, "Vertex layout must match the float attribute pointers");
+static_assert(sizeof(CompactVertex) == 16, "CompactVertex layout must match the compact attribute pointers");
+
+// Object space position = offset + attribute * scale, identity for the float layout.
+struct Quantization {
+    glm::vec3 offset = glm::vec3(0.0f),
+              scale = glm::vec3(1.0f);
+};
+
+// Largest difference to the float layout over all vertices of a mesh.
+struct VertexError {
+    float position, normalDegrees, textureCoordinates;
+};
+
+GLsizei vertex_size(VertexFormat format);
+// Points attributes 0-2 at the currently bound GL_ARRAY_BUFFER.
+void setup_vertex_attributes(VertexFormat format);
+
+Quantization quantization_for(const Bounds &bounds);
+vector<CompactVertex> compress_vertices(const Vertex *vertices, GLsizei count, const Quantization &quantization,
+                                        VertexError &error);
+
+#endif
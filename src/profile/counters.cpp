@@ -0,0 +1,76 @@
+#include "counters.h"
+#include <cstdio>
+
+uint64_t Counters::CURRENT[COUNTER_COUNT] {};
+uint64_t Counters::HISTORY[COUNTER_HISTORY][COUNTER_COUNT] {};
+uint64_t Counters::FRAMES[COUNTER_HISTORY] {};
+uint64_t Counters::FRAME = 0;
+
+static const char *COUNTER_NAMES[COUNTER_COUNT] {
+    "draw_calls",
+    "triangles",
+    "uniform_uploads",
+    "program_binds",
+    "texture_binds",
+    "vertex_array_binds",
+    "buffer_bytes_uploaded",
+    "texture_bytes_resident"
+};
+
+const char *Counters::get_name(Counter counter)
+{
+    return COUNTER_NAMES[(int)counter];
+}
+
+uint64_t Counters::get(Counter counter)
+{
+    if (!FRAME) {
+        return 0;
+    }
+
+    return HISTORY[(FRAME - 1) % COUNTER_HISTORY][(int)counter];
+}
+
+void Counters::end_frame()
+{
+    unsigned int slot = FRAME % COUNTER_HISTORY;
+
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        HISTORY[slot][i] = CURRENT[i];
+        if (i != (int)Counter::TEXTURE_BYTES_RESIDENT) {
+            CURRENT[i] = 0;
+        }
+    }
+    FRAMES[slot] = FRAME++;
+}
+
+bool Counters::write_csv(const string &path)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s for the counters.\n", path.c_str());
+        return false;
+    }
+
+    fprintf(file, "frame");
+    for (const char *name : COUNTER_NAMES) {
+        fprintf(file, ",%s", name);
+    }
+    fprintf(file, "\n");
+
+    uint64_t first = FRAME > COUNTER_HISTORY ? FRAME - COUNTER_HISTORY : 0;
+    for (uint64_t frame = first; frame < FRAME; frame++) {
+        unsigned int slot = frame % COUNTER_HISTORY;
+
+        fprintf(file, "%llu", (unsigned long long)FRAMES[slot]);
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            fprintf(file, ",%llu", (unsigned long long)HISTORY[slot][i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    bool written = !ferror(file);
+    fclose(file);
+
+    return written;
+}
@@ -0,0 +1,50 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+#define COUNTER_HISTORY 512
+
+enum class Counter {
+    DRAW_CALLS,
+    TRIANGLES,
+    UNIFORM_UPLOADS,
+    PROGRAM_BINDS,
+    TEXTURE_BINDS,
+    VERTEX_ARRAY_BINDS,
+    BUFFER_BYTES_UPLOADED,
+    // A level rather than a per frame total, never reset.
+    TEXTURE_BYTES_RESIDENT,
+    COUNT
+};
+
+#define COUNTER_COUNT ((int)Counter::COUNT)
+
+// Per frame totals fed from the GL call sites, the last COUNTER_HISTORY frames are kept in a ring.
+class Counters
+{
+    private:
+        static uint64_t CURRENT[COUNTER_COUNT];
+        static uint64_t HISTORY[COUNTER_HISTORY][COUNTER_COUNT];
+        static uint64_t FRAMES[COUNTER_HISTORY];
+        static uint64_t FRAME;
+
+    public:
+        static void add(Counter counter, uint64_t value = 1)
+        {
+            CURRENT[(int)counter] += value;
+        }
+
+        static const char *get_name(Counter counter);
+        // Value of the last completed frame.
+        static uint64_t get(Counter counter);
+
+        // Stores the frame in the history and starts the next one.
+        static void end_frame();
+        static bool write_csv(const string &path);
+};
+
+#endif
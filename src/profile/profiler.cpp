@@ -0,0 +1,159 @@
+#include "profiler.h"
+#include <cstdio>
+
+#define PROFILE_NO_EVENT 0xFFFFFFFFu
+
+Profiler &Profiler::get()
+{
+    // Never destroyed, its queries go away with the context.
+    static Profiler *profiler = new Profiler();
+
+    return *profiler;
+}
+
+uint64_t Profiler::now() const
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - EPOCH).count();
+}
+
+void Profiler::collect(unsigned int slot)
+{
+    for (unsigned int i = 0; i < GPU_ZONE_COUNT[slot]; i++) {
+        const GpuZone &zone = GPU_ZONES[slot][i];
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+
+        // GPU timestamps are moved onto the CPU timeline with the offset taken at capture start.
+        ProfileEvent &event = EVENTS[zone.event];
+        event.start = (uint64_t)((int64_t)start - GPU_EPOCH);
+        event.end = (uint64_t)((int64_t)end - GPU_EPOCH);
+    }
+
+    GPU_ZONE_COUNT[slot] = 0;
+}
+
+void Profiler::begin_frame()
+{
+    if (!QUERIES_CREATED) {
+        glGenQueries(PROFILER_GPU_FRAMES * PROFILER_GPU_ZONES * 2, &QUERIES[0][0][0]);
+        QUERIES_CREATED = true;
+    }
+
+    FRAME++;
+
+    // Results of the slot about to be reused are PROFILER_GPU_FRAMES frames old, normally ready without a stall.
+    collect(FRAME % PROFILER_GPU_FRAMES);
+}
+
+void Profiler::start_capture()
+{
+    EVENTS.clear();
+    EVENTS.reserve(PROFILER_MAX_EVENTS);
+    DROPPED = 0;
+    DEPTH = 0;
+
+    EPOCH = std::chrono::steady_clock::now();
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    GPU_EPOCH = gpuNow;
+
+    CAPTURING = true;
+}
+
+void Profiler::stop_capture()
+{
+    for (unsigned int slot = 0; slot < PROFILER_GPU_FRAMES; slot++) {
+        collect(slot);
+    }
+
+    CAPTURING = false;
+
+    if (DROPPED) {
+        fprintf(stderr, "Profiler dropped %zu events, the capture buffer holds %d.\n", DROPPED, PROFILER_MAX_EVENTS);
+    }
+}
+
+bool Profiler::capturing() const
+{
+    return CAPTURING;
+}
+
+uint32_t Profiler::begin_zone(const char *name, bool gpu)
+{
+    if (!CAPTURING) {
+        return PROFILE_NO_EVENT;
+    }
+
+    unsigned int slot = FRAME % PROFILER_GPU_FRAMES;
+    if (EVENTS.size() + (gpu ? 2 : 1) > PROFILER_MAX_EVENTS || (gpu && GPU_ZONE_COUNT[slot] == PROFILER_GPU_ZONES)) {
+        DROPPED++;
+        return PROFILE_NO_EVENT;
+    }
+
+    uint32_t event = (uint32_t)EVENTS.size();
+    EVENTS.push_back({name, now(), 0, DEPTH++, false});
+
+    if (gpu) {
+        // The GPU twin follows its CPU event, timestamps allow nesting where GL_TIME_ELAPSED does not.
+        GpuZone &zone = GPU_ZONES[slot][GPU_ZONE_COUNT[slot]];
+        zone.event = (uint32_t)EVENTS.size();
+        zone.queries[0] = QUERIES[slot][GPU_ZONE_COUNT[slot]][0];
+        zone.queries[1] = QUERIES[slot][GPU_ZONE_COUNT[slot]][1];
+        GPU_ZONE_COUNT[slot]++;
+
+        EVENTS.push_back({name, 0, 0, DEPTH - 1, true});
+        glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+    }
+
+    return event;
+}
+
+void Profiler::end_zone(uint32_t event, bool gpu)
+{
+    if (event == PROFILE_NO_EVENT || event >= EVENTS.size()) {
+        return;
+    }
+
+    if (gpu) {
+        unsigned int slot = FRAME % PROFILER_GPU_FRAMES;
+        for (unsigned int i = GPU_ZONE_COUNT[slot]; i-- > 0;) {
+            if (GPU_ZONES[slot][i].event == event + 1) {
+                glQueryCounter(GPU_ZONES[slot][i].queries[1], GL_TIMESTAMP);
+                break;
+            }
+        }
+    }
+
+    EVENTS[event].end = now();
+    DEPTH--;
+}
+
+bool Profiler::write_trace(const string &path) const
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s for the trace.\n", path.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n");
+    fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"GPU\"}}");
+
+    for (const ProfileEvent &event : EVENTS) {
+        if (event.end <= event.start) {
+            continue;
+        }
+
+        fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                event.name, event.gpu ? 2 : 1, event.start / 1000.0, (event.end - event.start) / 1000.0);
+    }
+
+    fprintf(file, "\n]}\n");
+    bool written = !ferror(file);
+    fclose(file);
+
+    return written;
+}
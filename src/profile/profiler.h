@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+using std::string;
+using std::vector;
+
+// Frames a GPU zone result may lag behind before it is read back.
+#define PROFILER_GPU_FRAMES 4
+#define PROFILER_GPU_ZONES  32
+#define PROFILER_MAX_EVENTS (1 << 18)
+
+struct ProfileEvent {
+    const char *name;
+    uint64_t    start, end;
+    uint32_t    depth;
+    bool        gpu;
+};
+
+// Records nested CPU and GPU zones while a capture is running and writes them as a
+// Chrome trace-event file, loadable in chrome://tracing or Perfetto. Zone names must be string literals.
+class Profiler
+{
+    private:
+        struct GpuZone {
+            uint32_t event;
+            GLuint   queries[2];
+        };
+
+        vector<ProfileEvent> EVENTS;
+        size_t               DROPPED = 0;
+        uint32_t             DEPTH = 0;
+        bool                 CAPTURING = false;
+
+        std::chrono::steady_clock::time_point EPOCH;
+        int64_t                               GPU_EPOCH = 0;
+
+        GLuint       QUERIES[PROFILER_GPU_FRAMES][PROFILER_GPU_ZONES][2] {};
+        GpuZone      GPU_ZONES[PROFILER_GPU_FRAMES][PROFILER_GPU_ZONES] {};
+        unsigned int GPU_ZONE_COUNT[PROFILER_GPU_FRAMES] {};
+        unsigned int FRAME = 0;
+        bool         QUERIES_CREATED = false;
+
+        uint64_t now() const;
+        void collect(unsigned int slot);
+
+    public:
+        static Profiler &get();
+
+        void begin_frame();
+        void start_capture();
+        // Waits for outstanding GPU zones.
+        void stop_capture();
+        bool capturing() const;
+        bool write_trace(const string &path) const;
+
+        uint32_t begin_zone(const char *name, bool gpu);
+        void end_zone(uint32_t event, bool gpu);
+};
+
+class ProfileZone
+{
+    private:
+        uint32_t EVENT;
+        bool     GPU;
+
+    public:
+        ProfileZone(const char *name, bool gpu) : GPU(gpu)
+        {
+            EVENT = Profiler::get().begin_zone(name, gpu);
+        }
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+        ~ProfileZone()
+        {
+            Profiler::get().end_zone(EVENT, GPU);
+        }
+};
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name, false)
+// Also times the GL commands issued in the scope, must be entered on the GL thread.
+#define PROFILE_GPU_ZONE(name) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name, true)
+
+#endif
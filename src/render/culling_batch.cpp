@@ -0,0 +1,131 @@
+#include "culling_batch.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+void CullingBatch::reserve(size_t count)
+{
+    CENTER_X.reserve(count);
+    CENTER_Y.reserve(count);
+    CENTER_Z.reserve(count);
+    RADIUS.reserve(count);
+    VISIBLE.reserve(count);
+}
+
+void CullingBatch::clear()
+{
+    CENTER_X.clear();
+    CENTER_Y.clear();
+    CENTER_Z.clear();
+    RADIUS.clear();
+}
+
+void CullingBatch::add(glm::vec3 center, float radius)
+{
+    CENTER_X.push_back(center.x);
+    CENTER_Y.push_back(center.y);
+    CENTER_Z.push_back(center.z);
+    RADIUS.push_back(radius);
+}
+
+void CullingBatch::add(const Bounds &bounds)
+{
+    add(bounds.center, bounds.radius);
+}
+
+size_t CullingBatch::size() const
+{
+    return RADIUS.size();
+}
+
+const vector<unsigned int> &CullingBatch::get_visible() const
+{
+    return VISIBLE;
+}
+
+const vector<unsigned int> &CullingBatch::cull(const Frustum &frustum)
+{
+    VISIBLE.clear();
+
+    size_t count = RADIUS.size();
+    size_t i = 0;
+
+#if defined(__AVX__)
+    __m256 planes[FRUSTUM_PLANES][4];
+    for (int p = 0; p < FRUSTUM_PLANES; p++) {
+        const glm::vec4 &plane = frustum.get_plane(p);
+        planes[p][0] = _mm256_set1_ps(plane.x);
+        planes[p][1] = _mm256_set1_ps(plane.y);
+        planes[p][2] = _mm256_set1_ps(plane.z);
+        planes[p][3] = _mm256_set1_ps(plane.w);
+    }
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(&CENTER_X[i]);
+        __m256 y = _mm256_loadu_ps(&CENTER_Y[i]);
+        __m256 z = _mm256_loadu_ps(&CENTER_Z[i]);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&RADIUS[i]));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (auto &plane : planes) {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(plane[0], x), _mm256_mul_ps(plane[1], y)),
+                _mm256_add_ps(_mm256_mul_ps(plane[2], z), plane[3])
+            );
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (unsigned int lane = 0; mask; lane++, mask >>= 1) {
+            if (mask & 1) {
+                VISIBLE.push_back(i + lane);
+            }
+        }
+    }
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+    __m128 planes4[FRUSTUM_PLANES][4];
+    for (int p = 0; p < FRUSTUM_PLANES; p++) {
+        const glm::vec4 &plane = frustum.get_plane(p);
+        planes4[p][0] = _mm_set1_ps(plane.x);
+        planes4[p][1] = _mm_set1_ps(plane.y);
+        planes4[p][2] = _mm_set1_ps(plane.z);
+        planes4[p][3] = _mm_set1_ps(plane.w);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(&CENTER_X[i]);
+        __m128 y = _mm_loadu_ps(&CENTER_Y[i]);
+        __m128 z = _mm_loadu_ps(&CENTER_Z[i]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&RADIUS[i]));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (auto &plane : planes4) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(plane[0], x), _mm_mul_ps(plane[1], y)),
+                _mm_add_ps(_mm_mul_ps(plane[2], z), plane[3])
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (unsigned int lane = 0; mask; lane++, mask >>= 1) {
+            if (mask & 1) {
+                VISIBLE.push_back(i + lane);
+            }
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (frustum.contains_sphere(glm::vec3(CENTER_X[i], CENTER_Y[i], CENTER_Z[i]), RADIUS[i])) {
+            VISIBLE.push_back(i);
+        }
+    }
+
+    return VISIBLE;
+}
@@ -0,0 +1,31 @@
+#ifndef CULLING_BATCH_H
+#define CULLING_BATCH_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "frustum.h"
+
+using std::vector;
+
+// Bounding spheres stored as structure of arrays so the frustum test
+// can run 8 (AVX) or 4 (SSE) spheres per iteration.
+class CullingBatch
+{
+    private:
+        vector<float>        CENTER_X, CENTER_Y, CENTER_Z, RADIUS;
+        vector<unsigned int> VISIBLE;
+
+    public:
+        void reserve(size_t count);
+        void clear();
+        void add(glm::vec3 center, float radius);
+        void add(const Bounds &bounds);
+        size_t size() const;
+
+        // Indices of the spheres intersecting the frustum, in insertion order.
+        const vector<unsigned int> &cull(const Frustum &frustum);
+        // Result of the last cull.
+        const vector<unsigned int> &get_visible() const;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include "deferred_renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <glm/gtc/constants.hpp>
+#include "light_clusters.h"
+#include "../shader/texture_units.h"
+#include "../profile/profiler.h"
+#include "../profile/counters.h"
+
+DeferredRenderer::DeferredRenderer()
+{
+    glGenVertexArrays(1, &FULLSCREEN_VAO);
+    create_light_volume();
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    delete_targets();
+    glDeleteVertexArrays(1, &FULLSCREEN_VAO);
+    glDeleteVertexArrays(1, &VOLUME_VAO);
+    glDeleteBuffers(1, &VOLUME_VBO);
+    glDeleteBuffers(1, &VOLUME_EBO);
+    glDeleteBuffers(1, &LIGHTS_VBO);
+}
+
+static GLuint create_target(GLenum internalFormat, GLenum format, GLenum type, int width, int height)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    return texture;
+}
+
+void DeferredRenderer::create_targets(int width, int height)
+{
+    WIDTH = width;
+    HEIGHT = height;
+
+    ALBEDO = create_target(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    NORMAL = create_target(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, width, height);
+    // Same format as the default framebuffer so the depth can be blitted into it.
+    DEPTH = create_target(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, FRAMEBUFFER);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ALBEDO, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, NORMAL, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, DEPTH, 0);
+
+    GLenum attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, attachments);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "G-buffer of %dx%d is incomplete.\n", width, height);
+    }
+}
+
+void DeferredRenderer::delete_targets()
+{
+    if (!FRAMEBUFFER) {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &FRAMEBUFFER);
+    GLuint textures[3] = {ALBEDO, NORMAL, DEPTH};
+    glDeleteTextures(3, textures);
+    FRAMEBUFFER = ALBEDO = NORMAL = DEPTH = 0;
+}
+
+void DeferredRenderer::create_light_volume()
+{
+    vector<glm::vec3> vertices;
+    vector<unsigned short> indices;
+
+    for (int ring = 0; ring <= LIGHT_VOLUME_RINGS; ring++) {
+        float polar = glm::pi<float>() * ring / LIGHT_VOLUME_RINGS;
+        for (int segment = 0; segment <= LIGHT_VOLUME_SEGMENTS; segment++) {
+            float azimuth = glm::two_pi<float>() * segment / LIGHT_VOLUME_SEGMENTS;
+            vertices.emplace_back(std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth));
+        }
+    }
+
+    for (int ring = 0; ring < LIGHT_VOLUME_RINGS; ring++) {
+        for (int segment = 0; segment < LIGHT_VOLUME_SEGMENTS; segment++) {
+            unsigned short current = (unsigned short)(ring * (LIGHT_VOLUME_SEGMENTS + 1) + segment);
+            unsigned short below = (unsigned short)(current + LIGHT_VOLUME_SEGMENTS + 1);
+
+            // Counter-clockwise seen from outside.
+            indices.insert(indices.end(), {current, (unsigned short)(current + 1), below});
+            indices.insert(indices.end(), {(unsigned short)(current + 1), (unsigned short)(below + 1), below});
+        }
+    }
+
+    // The faces of the polyhedron cut into the unit sphere, push them out to the
+    // closest face distance so the volume contains the whole range.
+    float inradius = 1.0f;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 a = vertices[indices[i]], b = vertices[indices[i + 1]], c = vertices[indices[i + 2]];
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        if (glm::length(normal) > 0.0f) {
+            inradius = std::min(inradius, std::abs(glm::dot(glm::normalize(normal), a)));
+        }
+    }
+    for (glm::vec3 &vertex : vertices) {
+        vertex /= inradius;
+    }
+    VOLUME_INDEX_COUNT = (GLsizei)indices.size();
+
+    glGenVertexArrays(1, &VOLUME_VAO);
+    glGenBuffers(1, &VOLUME_VBO);
+    glGenBuffers(1, &VOLUME_EBO);
+    glGenBuffers(1, &LIGHTS_VBO);
+
+    glBindVertexArray(VOLUME_VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VOLUME_VBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertices.size() * sizeof(glm::vec3)), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VOLUME_EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(unsigned short)), indices.data(), GL_STATIC_DRAW);
+
+    // One light per instance, laid out like the texels of the clustered light buffer.
+    GLsizei stride = POINT_LIGHT_TEXELS * sizeof(glm::vec4);
+    glBindBuffer(GL_ARRAY_BUFFER, LIGHTS_VBO);
+    glBufferData(GL_ARRAY_BUFFER, MAX_CLUSTERED_LIGHTS * stride, nullptr, GL_STREAM_DRAW);
+    for (GLuint texel = 0; texel < POINT_LIGHT_TEXELS; texel++) {
+        glEnableVertexAttribArray(1 + texel);
+        glVertexAttribPointer(1 + texel, 4, GL_FLOAT, GL_FALSE, stride, (void*)(texel * sizeof(glm::vec4)));
+        glVertexAttribDivisor(1 + texel, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredRenderer::begin_geometry(int width, int height)
+{
+    if (width != WIDTH || height != HEIGHT || !FRAMEBUFFER) {
+        delete_targets();
+        create_targets(width, height);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FRAMEBUFFER);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredRenderer::end_geometry()
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FRAMEBUFFER);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DeferredRenderer::light(const Shader &directional, const Shader &point, const glm::mat4 &viewProjection, const vector<glm::vec4> &pointLights)
+{
+    PROFILE_GPU_ZONE("deferred lighting");
+
+    glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_ALBEDO_UNIT);
+    glBindTexture(GL_TEXTURE_2D, ALBEDO);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_NORMAL_UNIT);
+    glBindTexture(GL_TEXTURE_2D, NORMAL);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_DEPTH_UNIT);
+    glBindTexture(GL_TEXTURE_2D, DEPTH);
+    glActiveTexture(GL_TEXTURE0);
+    Counters::add(Counter::TEXTURE_BINDS, 3);
+
+    // Lighting reads the depth it tests against, it must never write it.
+    glDepthMask(GL_FALSE);
+
+    // Directional lights overwrite the cleared background wherever there is geometry.
+    glDisable(GL_DEPTH_TEST);
+    directional.use();
+    directional.setUniformMatrix(directional.objectUniforms().inverseViewProjection, inverseViewProjection);
+    glBindVertexArray(FULLSCREEN_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    Counters::add(Counter::PROGRAM_BINDS);
+    Counters::add(Counter::DRAW_CALLS);
+    Counters::add(Counter::TRIANGLES);
+
+    GLsizei lightCount = (GLsizei)std::min(pointLights.size() / POINT_LIGHT_TEXELS, (size_t)MAX_CLUSTERED_LIGHTS);
+    if (lightCount) {
+        GLsizeiptr size = lightCount * POINT_LIGHT_TEXELS * sizeof(glm::vec4);
+        glBindBuffer(GL_ARRAY_BUFFER, LIGHTS_VBO);
+        glBufferData(GL_ARRAY_BUFFER, MAX_CLUSTERED_LIGHTS * POINT_LIGHT_TEXELS * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, pointLights.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        Counters::add(Counter::BUFFER_BYTES_UPLOADED, (uint64_t)size);
+
+        // Back faces pass where they lie behind the stored surface, depth clamping
+        // keeps the ones past the far plane. Overlapping lights add up.
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_GEQUAL);
+        glEnable(GL_DEPTH_CLAMP);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        point.use();
+        point.setUniformMatrix(point.objectUniforms().inverseViewProjection, inverseViewProjection);
+        glBindVertexArray(VOLUME_VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, VOLUME_INDEX_COUNT, GL_UNSIGNED_SHORT, nullptr, lightCount);
+        Counters::add(Counter::PROGRAM_BINDS);
+        Counters::add(Counter::DRAW_CALLS);
+        Counters::add(Counter::TRIANGLES, (uint64_t)(VOLUME_INDEX_COUNT / 3) * lightCount);
+
+        glDisable(GL_BLEND);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_CLAMP);
+        glDepthFunc(GL_LESS);
+    }
+
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+}
@@ -0,0 +1,47 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../shader/shader.h"
+
+using std::vector;
+
+#define LIGHT_VOLUME_SEGMENTS 16
+#define LIGHT_VOLUME_RINGS    8
+
+// Alternative to shading in the scene pass: the render queue fills a G-buffer
+// (albedo + specular, normal, depth), then the lights are accumulated into the
+// default framebuffer. Directional lights are one fullscreen pass, every point
+// light is the back faces of a sphere of its attenuation range drawn instanced,
+// with a GEQUAL depth test so pixels whose surface lies behind the volume are
+// never shaded.
+class DeferredRenderer
+{
+    private:
+        GLuint  FRAMEBUFFER = 0, ALBEDO = 0, NORMAL = 0, DEPTH = 0;
+        int     WIDTH = 0, HEIGHT = 0;
+        GLuint  FULLSCREEN_VAO = 0;
+        GLuint  VOLUME_VAO = 0, VOLUME_VBO = 0, VOLUME_EBO = 0, LIGHTS_VBO = 0;
+        GLsizei VOLUME_INDEX_COUNT = 0;
+
+        void create_targets(int width, int height);
+        void delete_targets();
+        void create_light_volume();
+
+    public:
+        DeferredRenderer();
+        DeferredRenderer(const DeferredRenderer&) = delete;
+        DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+        ~DeferredRenderer();
+
+        // Binds and clears the G-buffer, resized to the framebuffer first.
+        void begin_geometry(int width, int height);
+        // Rebinds the default framebuffer with the G-buffer depth copied in, for passes drawn after lighting.
+        void end_geometry();
+        // pointLights holds POINT_LIGHT_TEXELS vec4s per light, the layout of LightClusters::get_light_data().
+        void light(const Shader &directional, const Shader &point, const glm::mat4 &viewProjection, const vector<glm::vec4> &pointLights);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "frustum.h"
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+    glm::mat4 rows = glm::transpose(viewProjection);
+
+    PLANES[0] = rows[3] + rows[0];
+    PLANES[1] = rows[3] - rows[0];
+    PLANES[2] = rows[3] + rows[1];
+    PLANES[3] = rows[3] - rows[1];
+    PLANES[4] = rows[3] + rows[2];
+    PLANES[5] = rows[3] - rows[2];
+
+    for (glm::vec4 &plane : PLANES) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+const glm::vec4 &Frustum::get_plane(int index) const
+{
+    return PLANES[index];
+}
+
+bool Frustum::contains_sphere(glm::vec3 center, float radius) const
+{
+    for (const glm::vec4 &plane : PLANES) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Frustum::contains(const Bounds &bounds) const
+{
+    if (!contains_sphere(bounds.center, bounds.radius)) {
+        return false;
+    }
+
+    // The sphere is loose for long thin meshes, refine with the box's positive vertex.
+    for (const glm::vec4 &plane : PLANES) {
+        glm::vec3 positive(
+            plane.x >= 0 ? bounds.max.x : bounds.min.x,
+            plane.y >= 0 ? bounds.max.y : bounds.min.y,
+            plane.z >= 0 ? bounds.max.z : bounds.min.z
+        );
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
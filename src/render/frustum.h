@@ -0,0 +1,22 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include "../model/bounds.h"
+
+#define FRUSTUM_PLANES 6
+
+class Frustum
+{
+    private:
+        // Normalised planes (xyz = inward normal, w = distance) in left, right, bottom, top, near, far order.
+        glm::vec4 PLANES[FRUSTUM_PLANES];
+
+    public:
+        explicit Frustum(const glm::mat4 &viewProjection);
+        const glm::vec4 &get_plane(int index) const;
+        bool contains_sphere(glm::vec3 center, float radius) const;
+        bool contains(const Bounds &bounds) const;
+};
+
+#endif
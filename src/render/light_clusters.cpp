@@ -0,0 +1,306 @@
+#include "light_clusters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "../shader/texture_units.h"
+#include "../profile/profiler.h"
+#include "../profile/counters.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Starting size of the index list, grown when a frame needs more.
+#define CLUSTER_INDEX_CAPACITY (CLUSTER_COUNT * 32)
+
+static void create_texture_buffer(GLuint &buffer, GLuint &texture, GLenum format, GLsizeiptr capacity)
+{
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightClusters::LightClusters()
+{
+    for (vector<float> *bounds : {&MIN_X, &MIN_Y, &MIN_Z, &MAX_X, &MAX_Y, &MAX_Z}) {
+        bounds->resize(CLUSTER_COUNT);
+    }
+    for (vector<float> *lights : {&CENTER_X, &CENTER_Y, &CENTER_Z, &RADIUS}) {
+        lights->reserve(MAX_CLUSTERED_LIGHTS);
+    }
+    LIGHT_DATA.reserve(MAX_CLUSTERED_LIGHTS * POINT_LIGHT_TEXELS);
+    REFERENCES.reserve(CLUSTER_INDEX_CAPACITY);
+    INDICES.reserve(CLUSTER_INDEX_CAPACITY);
+    GRID.resize(CLUSTER_COUNT * 2);
+    CURSORS.resize(CLUSTER_COUNT);
+
+    GRID_BUFFER.capacity = CLUSTER_COUNT * 2 * sizeof(uint32_t);
+    INDEX_BUFFER.capacity = CLUSTER_INDEX_CAPACITY * sizeof(uint16_t);
+    LIGHT_BUFFER.capacity = MAX_CLUSTERED_LIGHTS * POINT_LIGHT_TEXELS * sizeof(glm::vec4);
+    create_texture_buffer(GRID_BUFFER.buffer, GRID_BUFFER.texture, GL_RG32UI, GRID_BUFFER.capacity);
+    create_texture_buffer(INDEX_BUFFER.buffer, INDEX_BUFFER.texture, GL_R16UI, INDEX_BUFFER.capacity);
+    create_texture_buffer(LIGHT_BUFFER.buffer, LIGHT_BUFFER.texture, GL_RGBA32F, LIGHT_BUFFER.capacity);
+
+    BLOCK.tilesX = CLUSTER_TILES_X;
+    BLOCK.tilesY = CLUSTER_TILES_Y;
+    BLOCK.slices = CLUSTER_SLICES;
+}
+
+LightClusters::~LightClusters()
+{
+    for (TextureBuffer *target : {&GRID_BUFFER, &INDEX_BUFFER, &LIGHT_BUFFER}) {
+        glDeleteTextures(1, &target->texture);
+        glDeleteBuffers(1, &target->buffer);
+    }
+}
+
+void LightClusters::build_clusters(const glm::mat4 &projection)
+{
+    PROJECTION = projection;
+
+    // Near and far planes of a GL perspective matrix.
+    float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    float farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+    float logRatio = std::log(farPlane / nearPlane);
+
+    BLOCK.nearPlane = nearPlane;
+    BLOCK.farPlane = farPlane;
+    BLOCK.sliceScale = CLUSTER_SLICES / logRatio;
+    BLOCK.sliceBias = -CLUSTER_SLICES * std::log(nearPlane) / logRatio;
+
+    // View space rays through the tile corners, scaled to unit depth.
+    glm::mat4 inverse = glm::inverse(projection);
+    glm::vec3 rays[CLUSTER_TILES_Y + 1][CLUSTER_TILES_X + 1];
+    for (int y = 0; y <= CLUSTER_TILES_Y; y++) {
+        for (int x = 0; x <= CLUSTER_TILES_X; x++) {
+            glm::vec4 corner = inverse * glm::vec4(
+                -1.0f + 2.0f * x / CLUSTER_TILES_X,
+                -1.0f + 2.0f * y / CLUSTER_TILES_Y,
+                -1.0f,
+                1.0f
+            );
+            glm::vec3 point = glm::vec3(corner) / corner.w;
+            rays[y][x] = point / -point.z;
+        }
+    }
+
+    for (int slice = 0; slice < CLUSTER_SLICES; slice++) {
+        float depths[2] = {
+            nearPlane * std::pow(farPlane / nearPlane, (float)slice / CLUSTER_SLICES),
+            nearPlane * std::pow(farPlane / nearPlane, (float)(slice + 1) / CLUSTER_SLICES),
+        };
+
+        for (int y = 0; y < CLUSTER_TILES_Y; y++) {
+            for (int x = 0; x < CLUSTER_TILES_X; x++) {
+                glm::vec3 low(INFINITY), high(-INFINITY);
+                for (float depth : depths) {
+                    for (const glm::vec3 &ray : {rays[y][x], rays[y][x + 1], rays[y + 1][x], rays[y + 1][x + 1]}) {
+                        low = glm::min(low, ray * depth);
+                        high = glm::max(high, ray * depth);
+                    }
+                }
+
+                size_t cluster = (size_t)slice * CLUSTER_TILES + y * CLUSTER_TILES_X + x;
+                MIN_X[cluster] = low.x;
+                MIN_Y[cluster] = low.y;
+                MIN_Z[cluster] = low.z;
+                MAX_X[cluster] = high.x;
+                MAX_Y[cluster] = high.y;
+                MAX_Z[cluster] = high.z;
+            }
+        }
+    }
+}
+
+void LightClusters::gather_lights(const glm::mat4 &view, const vector<unique_ptr<Light>> &lights)
+{
+    CENTER_X.clear();
+    CENTER_Y.clear();
+    CENTER_Z.clear();
+    RADIUS.clear();
+    LIGHT_DATA.clear();
+
+    for (const unique_ptr<Light> &light : lights) {
+        if (light->get_type() != LightType::POINT || RADIUS.size() == MAX_CLUSTERED_LIGHTS) {
+            continue;
+        }
+
+        float range = light->get_range();
+        if (range <= 0.0f) {
+            continue;
+        }
+
+        glm::vec3 position = light->get_position();
+        glm::vec4 center = view * glm::vec4(position, 1.0f);
+        CENTER_X.push_back(center.x);
+        CENTER_Y.push_back(center.y);
+        CENTER_Z.push_back(center.z);
+        RADIUS.push_back(range);
+
+        LIGHT_DATA.emplace_back(position, range);
+        LIGHT_DATA.emplace_back(light->get_ambient(), light->get_constant());
+        LIGHT_DATA.emplace_back(light->get_diffuse(), light->get_linear());
+        LIGHT_DATA.emplace_back(light->get_specular(), light->get_quadratic());
+    }
+}
+
+static int slice_for(const ClusterBlock &block, float depth)
+{
+    int slice = (int)(std::log(depth) * block.sliceScale + block.sliceBias);
+
+    return std::min(std::max(slice, 0), CLUSTER_SLICES - 1);
+}
+
+void LightClusters::bin_light(uint32_t light)
+{
+    float x = CENTER_X[light], y = CENTER_Y[light], z = CENTER_Z[light], radius = RADIUS[light];
+    float depth = -z;
+    if (depth + radius < BLOCK.nearPlane || depth - radius > BLOCK.farPlane) {
+        return;
+    }
+
+    int firstSlice = slice_for(BLOCK, std::max(depth - radius, BLOCK.nearPlane));
+    int lastSlice = slice_for(BLOCK, std::min(depth + radius, BLOCK.farPlane));
+    float radiusSquared = radius * radius;
+
+    // References pack the cluster in the high and the light in the low 16 bits.
+    for (int slice = firstSlice; slice <= lastSlice; slice++) {
+        uint32_t first = (uint32_t)slice * CLUSTER_TILES, end = first + CLUSTER_TILES;
+        uint32_t i = first;
+
+        // Squared distance from the sphere center to the cluster box, per axis
+        // only one of (min - center) and (center - max) can be positive.
+#if defined(__AVX__)
+        __m256 x8 = _mm256_set1_ps(x), y8 = _mm256_set1_ps(y), z8 = _mm256_set1_ps(z);
+        __m256 radius8 = _mm256_set1_ps(radiusSquared), zero8 = _mm256_setzero_ps();
+        for (; i + 8 <= end; i += 8) {
+            __m256 dx = _mm256_max_ps(zero8, _mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(&MIN_X[i]), x8), _mm256_sub_ps(x8, _mm256_loadu_ps(&MAX_X[i]))));
+            __m256 dy = _mm256_max_ps(zero8, _mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(&MIN_Y[i]), y8), _mm256_sub_ps(y8, _mm256_loadu_ps(&MAX_Y[i]))));
+            __m256 dz = _mm256_max_ps(zero8, _mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(&MIN_Z[i]), z8), _mm256_sub_ps(z8, _mm256_loadu_ps(&MAX_Z[i]))));
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+            int mask = _mm256_movemask_ps(_mm256_cmp_ps(distance, radius8, _CMP_LE_OQ));
+            for (uint32_t lane = 0; mask; lane++, mask >>= 1) {
+                if (mask & 1) {
+                    REFERENCES.push_back((i + lane) << 16 | light);
+                }
+            }
+        }
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+        __m128 x4 = _mm_set1_ps(x), y4 = _mm_set1_ps(y), z4 = _mm_set1_ps(z);
+        __m128 radius4 = _mm_set1_ps(radiusSquared), zero4 = _mm_setzero_ps();
+        for (; i + 4 <= end; i += 4) {
+            __m128 dx = _mm_max_ps(zero4, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&MIN_X[i]), x4), _mm_sub_ps(x4, _mm_loadu_ps(&MAX_X[i]))));
+            __m128 dy = _mm_max_ps(zero4, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&MIN_Y[i]), y4), _mm_sub_ps(y4, _mm_loadu_ps(&MAX_Y[i]))));
+            __m128 dz = _mm_max_ps(zero4, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&MIN_Z[i]), z4), _mm_sub_ps(z4, _mm_loadu_ps(&MAX_Z[i]))));
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+            int mask = _mm_movemask_ps(_mm_cmple_ps(distance, radius4));
+            for (uint32_t lane = 0; mask; lane++, mask >>= 1) {
+                if (mask & 1) {
+                    REFERENCES.push_back((i + lane) << 16 | light);
+                }
+            }
+        }
+#endif
+
+        for (; i < end; i++) {
+            float dx = std::max(0.0f, std::max(MIN_X[i] - x, x - MAX_X[i]));
+            float dy = std::max(0.0f, std::max(MIN_Y[i] - y, y - MAX_Y[i]));
+            float dz = std::max(0.0f, std::max(MIN_Z[i] - z, z - MAX_Z[i]));
+            if (dx * dx + dy * dy + dz * dz <= radiusSquared) {
+                REFERENCES.push_back(i << 16 | light);
+            }
+        }
+    }
+}
+
+void LightClusters::upload(TextureBuffer &target, const void *data, GLsizeiptr size)
+{
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+
+    // Orphan the storage so the driver does not wait for last frame's draws.
+    target.capacity = std::max(target.capacity, size);
+    glBufferData(GL_TEXTURE_BUFFER, target.capacity, nullptr, GL_STREAM_DRAW);
+    if (size) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        Counters::add(Counter::BUFFER_BYTES_UPLOADED, (uint64_t)size);
+    }
+}
+
+void LightClusters::update(const glm::mat4 &projection, const glm::mat4 &view, const vector<unique_ptr<Light>> &lights)
+{
+    PROFILE_ZONE("light binning");
+
+    if (projection != PROJECTION) {
+        build_clusters(projection);
+    }
+
+    gather_lights(view, lights);
+    BLOCK.lightCount = (uint32_t)RADIUS.size();
+
+    REFERENCES.clear();
+    for (uint32_t light = 0; light < BLOCK.lightCount; light++) {
+        bin_light(light);
+    }
+
+    // Counting sort of the references into one contiguous list per cluster.
+    std::fill(GRID.begin(), GRID.end(), 0u);
+    for (uint32_t reference : REFERENCES) {
+        GRID[(reference >> 16) * 2 + 1]++;
+    }
+
+    uint32_t offset = 0;
+    for (size_t cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+        GRID[cluster * 2] = offset;
+        CURSORS[cluster] = offset;
+        offset += GRID[cluster * 2 + 1];
+    }
+
+    INDICES.resize(REFERENCES.size());
+    for (uint32_t reference : REFERENCES) {
+        INDICES[CURSORS[reference >> 16]++] = (uint16_t)(reference & 0xFFFF);
+    }
+
+    BLOCK_BUFFER.update(&BLOCK);
+    upload(GRID_BUFFER, GRID.data(), (GLsizeiptr)(GRID.size() * sizeof(uint32_t)));
+    upload(INDEX_BUFFER, INDICES.data(), (GLsizeiptr)(INDICES.size() * sizeof(uint16_t)));
+    upload(LIGHT_BUFFER, LIGHT_DATA.data(), (GLsizeiptr)(LIGHT_DATA.size() * sizeof(glm::vec4)));
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // The render queue only binds material units and restores nothing else, so these stay bound.
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, GRID_BUFFER.texture);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_INDICES_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, INDEX_BUFFER.texture);
+    glActiveTexture(GL_TEXTURE0 + POINT_LIGHTS_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, LIGHT_BUFFER.texture);
+    glActiveTexture(GL_TEXTURE0);
+    Counters::add(Counter::TEXTURE_BINDS, 3);
+}
+
+unsigned int LightClusters::get_light_count() const
+{
+    return BLOCK.lightCount;
+}
+
+const vector<glm::vec4> &LightClusters::get_light_data() const
+{
+    return LIGHT_DATA;
+}
+
+size_t LightClusters::get_reference_count() const
+{
+    return INDICES.size();
+}
@@ -0,0 +1,72 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../light/light.h"
+#include "../shader/uniform_blocks.h"
+#include "../shader/uniform_buffer.h"
+
+using std::vector;
+using std::unique_ptr;
+
+#define CLUSTER_TILES_X      16
+#define CLUSTER_TILES_Y      9
+#define CLUSTER_SLICES       24
+#define CLUSTER_TILES        (CLUSTER_TILES_X * CLUSTER_TILES_Y)
+#define CLUSTER_COUNT        (CLUSTER_TILES * CLUSTER_SLICES)
+#define MAX_CLUSTERED_LIGHTS 1024
+// vec4 texels per light: position, ambient + constant, diffuse + linear, specular + quadratic.
+#define POINT_LIGHT_TEXELS   4
+
+// Assigns point lights to view space froxels: screen tiles split into
+// exponentially growing depth slices. Every frame the lights are binned on
+// the CPU and the fragment shader reads the lights of its cluster from three
+// buffer textures: an (offset, count) pair per cluster, the light index list
+// and the light data itself.
+class LightClusters
+{
+    private:
+        struct TextureBuffer {
+            GLuint     buffer = 0, texture = 0;
+            GLsizeiptr capacity = 0;
+        };
+
+        glm::mat4 PROJECTION{0.0f};
+        // View space bounds of every cluster, slice major so one slice is CLUSTER_TILES contiguous floats.
+        vector<float> MIN_X, MIN_Y, MIN_Z, MAX_X, MAX_Y, MAX_Z;
+
+        vector<float>     CENTER_X, CENTER_Y, CENTER_Z, RADIUS;
+        vector<glm::vec4> LIGHT_DATA;
+        vector<uint32_t>  REFERENCES, GRID, CURSORS;
+        vector<uint16_t>  INDICES;
+
+        ClusterBlock  BLOCK{};
+        UniformBuffer BLOCK_BUFFER{CLUSTERS_BLOCK_BINDING, sizeof(ClusterBlock)};
+        TextureBuffer GRID_BUFFER, INDEX_BUFFER, LIGHT_BUFFER;
+
+        void build_clusters(const glm::mat4 &projection);
+        void gather_lights(const glm::mat4 &view, const vector<unique_ptr<Light>> &lights);
+        void bin_light(uint32_t light);
+        void upload(TextureBuffer &target, const void *data, GLsizeiptr size);
+
+    public:
+        LightClusters();
+        LightClusters(const LightClusters&) = delete;
+        LightClusters& operator=(const LightClusters&) = delete;
+        ~LightClusters();
+
+        // Rebins the point lights for the camera and binds the buffer textures to their units.
+        void update(const glm::mat4 &projection, const glm::mat4 &view, const vector<unique_ptr<Light>> &lights);
+
+        unsigned int get_light_count() const;
+        // POINT_LIGHT_TEXELS vec4s per clustered light, as uploaded by the last update().
+        const vector<glm::vec4> &get_light_data() const;
+        // Light references over all clusters, the length of the index list.
+        size_t get_reference_count() const;
+};
+
+#endif
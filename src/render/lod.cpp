@@ -0,0 +1,45 @@
+#include "lod.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+float lod_pixel_scale(const glm::mat4 &projection, int viewportHeight)
+{
+    // projection[1][1] is cot(fov / 2), the visible height at distance one is 2 / projection[1][1].
+    return projection[1][1] * (float)viewportHeight * 0.5f;
+}
+
+float projected_radius(glm::vec3 center, float radius, glm::vec3 eye, float pixelScale)
+{
+    glm::vec3 offset = center - eye;
+    float distanceSquared = glm::dot(offset, offset) - radius * radius;
+    if (distanceSquared <= 0.0f) {
+        return FLT_MAX;
+    }
+
+    return radius * pixelScale / std::sqrt(distanceSquared);
+}
+
+unsigned int select_lod(const vector<float> &errors, float projectedRadius, unsigned int previous)
+{
+    if (errors.empty()) {
+        return 0;
+    }
+
+    unsigned int lod = std::min(previous, (unsigned int)errors.size() - 1);
+
+    // Too coarse for this size, refine past the band straight to the level that fits.
+    if (errors[lod] * projectedRadius > LOD_PIXEL_ERROR * (1.0f + LOD_HYSTERESIS)) {
+        while (lod > 0 && errors[lod] * projectedRadius > LOD_PIXEL_ERROR) {
+            lod--;
+        }
+        return lod;
+    }
+
+    // Only coarsen once the next level is comfortably under the threshold.
+    while (lod + 1 < errors.size() && errors[lod + 1] * projectedRadius <= LOD_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS)) {
+        lod++;
+    }
+
+    return lod;
+}
@@ -0,0 +1,24 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+using std::vector;
+
+// Largest on screen error, in pixels, a detail level may show.
+#define LOD_PIXEL_ERROR 1.0f
+// Fraction of LOD_PIXEL_ERROR the error has to cross past the threshold before the level changes.
+#define LOD_HYSTERESIS  0.25f
+
+// Pixels covered by one unit at distance one, for a perspective projection and viewport height.
+float lod_pixel_scale(const glm::mat4 &projection, int viewportHeight);
+// Radius in pixels of a sphere seen from eye, infinite when the eye is inside.
+float projected_radius(glm::vec3 center, float radius, glm::vec3 eye, float pixelScale);
+
+// Coarsest level whose error, relative to the bounding radius as in Model::get_lod_errors(), stays
+// under LOD_PIXEL_ERROR at the projected radius. Keeps previous while its error is inside the
+// hysteresis band so objects resting near a threshold do not flicker between two levels.
+unsigned int select_lod(const vector<float> &errors, float projectedRadius, unsigned int previous);
+
+#endif
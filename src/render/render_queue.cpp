@@ -0,0 +1,205 @@
+#include "render_queue.h"
+#include "../profile/profiler.h"
+#include "../profile/counters.h"
+#include "../model/normal_matrix.h"
+#include <cstring>
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+uint64_t RenderQueue::make_key(GLuint program, GLuint material, GLuint vertexArray, float depth, SortMode mode)
+{
+    // The bit pattern of a non-negative float grows with its value, its top
+    // 16 bits (exponent and 7 bits of mantissa) are a cheap monotonic depth.
+    depth = depth > 0.0f ? depth : 0.0f;
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+    if (mode == SortMode::FRONT_TO_BACK) {
+        return (uint64_t)(depthBits >> 16) << 48
+             | (uint64_t)(program & 0xFFFF) << 32
+             | (uint64_t)(material & 0xFFFF) << 16
+             | (uint64_t)(vertexArray & 0xFFFF);
+    }
+
+    return (uint64_t)(program & 0xFFFF) << 48
+         | (uint64_t)(material & 0xFFFF) << 32
+         | (uint64_t)(vertexArray & 0xFFFF) << 16
+         | (uint64_t)(depthBits >> 16);
+}
+
+void RenderQueue::set_sort_mode(SortMode mode)
+{
+    SORT_MODE = mode;
+}
+
+SortMode RenderQueue::get_sort_mode() const
+{
+    return SORT_MODE;
+}
+
+void RenderQueue::clear()
+{
+    PACKETS.clear();
+}
+
+void RenderQueue::submit(ShaderVariants &variants, ShaderFeatures features, const Model &model, const glm::mat4 &transform, float depth,
+                         glm::vec3 color, unsigned int lod)
+{
+    glm::mat3 normal = normal_matrix(transform);
+
+    for (const Mesh &mesh : model.get_meshes()) {
+        features.specularMap = mesh.get_material().has(TextureSlot::SPECULAR);
+        const Shader &shader = variants.get(features);
+
+        DrawPacket packet;
+        packet.key = make_key(shader.id(), mesh.get_material().get_id(), mesh.get_vao(), depth, SORT_MODE);
+        packet.shader = &shader;
+        packet.mesh = &mesh;
+        packet.model = transform;
+        packet.normal = normal;
+        packet.color = color;
+        packet.lod = lod;
+        packet.firstInstance = 0;
+        packet.instances = 0;
+
+        PACKETS.push_back(packet);
+    }
+}
+
+void RenderQueue::submit_instanced(ShaderVariants &variants, ShaderFeatures features, const Model &model, float depth)
+{
+    if (!model.get_instance_count()) {
+        return;
+    }
+
+    for (const Mesh &mesh : model.get_meshes()) {
+        features.specularMap = mesh.get_material().has(TextureSlot::SPECULAR);
+        const Shader &shader = variants.get(features);
+
+        GLsizei firstInstance = 0;
+        for (unsigned int lod = 0; lod < model.get_lod_count(); lod++) {
+            GLsizei instances = model.get_lod_instance_count(lod);
+            if (!instances) {
+                continue;
+            }
+
+            DrawPacket packet;
+            packet.key = make_key(shader.id(), mesh.get_material().get_id(), mesh.get_vao(), depth, SORT_MODE);
+            packet.shader = &shader;
+            packet.mesh = &mesh;
+            packet.model = glm::mat4(1.0f);
+            packet.normal = glm::mat3(1.0f);
+            packet.color = glm::vec3(1.0f);
+            packet.lod = lod;
+            packet.firstInstance = firstInstance;
+            packet.instances = instances;
+
+            PACKETS.push_back(packet);
+            firstInstance += instances;
+        }
+    }
+}
+
+void RenderQueue::sort()
+{
+    size_t count = PACKETS.size();
+    ORDER.resize(count);
+    ORDER_SCRATCH.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        ORDER[i] = (uint32_t)i;
+    }
+
+    // Stable LSD radix sort over the key bytes, skipping bytes all packets share.
+    for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+        size_t histogram[RADIX_SIZE] = {};
+        for (uint32_t index : ORDER) {
+            histogram[(PACKETS[index].key >> shift) & (RADIX_SIZE - 1)]++;
+        }
+
+        if (!count || histogram[(PACKETS[ORDER[0]].key >> shift) & (RADIX_SIZE - 1)] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t &bucket : histogram) {
+            size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+
+        for (uint32_t index : ORDER) {
+            ORDER_SCRATCH[histogram[(PACKETS[index].key >> shift) & (RADIX_SIZE - 1)]++] = index;
+        }
+        ORDER.swap(ORDER_SCRATCH);
+    }
+}
+
+void RenderQueue::flush()
+{
+    PROFILE_GPU_ZONE("scene pass");
+
+    {
+        PROFILE_ZONE("sort");
+        sort();
+    }
+
+    CACHE.invalidate();
+    CACHE.reset_counters();
+
+    STATS = {};
+    STATS.packets = (unsigned int)PACKETS.size();
+
+    unsigned int boundMaterial = 0;
+
+    for (uint32_t index : ORDER) {
+        const DrawPacket &packet = PACKETS[index];
+        const Shader &shader = *packet.shader;
+        const Mesh &mesh = *packet.mesh;
+
+        CACHE.use_program(shader.id());
+
+        // Samplers point at fixed units in every program, only a new material needs new bindings.
+        if (shader.samplesMaterial() && boundMaterial != mesh.get_material().get_id()) {
+            mesh.get_material().bind(CACHE);
+            boundMaterial = mesh.get_material().get_id();
+        }
+
+        CACHE.bind_vertex_array(mesh.get_vao());
+
+        const ObjectUniforms &uniforms = shader.objectUniforms();
+        if (uniforms.model.valid()) {
+            shader.setUniformMatrix(uniforms.model, packet.model);
+        }
+        if (uniforms.normalMatrix.valid()) {
+            shader.setUniformMatrix(uniforms.normalMatrix, packet.normal);
+        }
+        if (uniforms.color.valid()) {
+            shader.setUniformVec3(uniforms.color, packet.color);
+        }
+        mesh.apply_quantization(shader);
+
+        GLsizei indexCount = mesh.get_index_count(packet.lod);
+        if (packet.instances) {
+            mesh.set_first_instance(packet.firstInstance);
+            glDrawElementsInstanced(GL_TRIANGLES, indexCount, mesh.get_index_type(), mesh.get_index_offset(packet.lod), packet.instances);
+        } else {
+            glDrawElements(GL_TRIANGLES, indexCount, mesh.get_index_type(), mesh.get_index_offset(packet.lod));
+        }
+        unsigned long triangles = (unsigned long)(indexCount / 3) * (packet.instances ? packet.instances : 1);
+        STATS.drawCalls++;
+        STATS.triangles += triangles;
+        Counters::add(Counter::DRAW_CALLS);
+        Counters::add(Counter::TRIANGLES, triangles);
+    }
+
+    CACHE.bind_vertex_array(0);
+
+    STATS.stateChanges = CACHE.get_changes();
+    STATS.stateChangesAvoided = CACHE.get_avoided();
+}
+
+const RenderStats &RenderQueue::get_stats() const
+{
+    return STATS;
+}
@@ -0,0 +1,68 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../shader/shader.h"
+#include "../shader/shader_variants.h"
+#include "../model/model.h"
+#include "state_cache.h"
+
+using std::vector;
+
+struct DrawPacket {
+    uint64_t     key;
+    const Shader *shader;
+    const Mesh   *mesh;
+    glm::mat4    model;
+    glm::mat3    normal;
+    glm::vec3    color;
+    unsigned int lod;
+    GLsizei      firstInstance, instances;
+};
+
+// STATE groups draws by program, material and vertex array and only orders by
+// depth within a group. FRONT_TO_BACK orders by depth first so early depth
+// testing rejects as many occluded fragments as possible.
+enum class SortMode {
+    STATE,
+    FRONT_TO_BACK,
+};
+
+struct RenderStats {
+    unsigned int packets, drawCalls, stateChanges, stateChangesAvoided;
+    unsigned long triangles;
+};
+
+// Collects the draws of a frame, sorts them by program, material, vertex
+// array and depth and submits them through a StateCache.
+class RenderQueue
+{
+    private:
+        vector<DrawPacket> PACKETS;
+        vector<uint32_t>   ORDER, ORDER_SCRATCH;
+        StateCache         CACHE;
+        RenderStats        STATS{};
+        SortMode           SORT_MODE = SortMode::STATE;
+
+        void sort();
+
+    public:
+        static uint64_t make_key(GLuint program, GLuint material, GLuint vertexArray, float depth, SortMode mode = SortMode::STATE);
+
+        // Applies to the packets submitted afterwards.
+        void set_sort_mode(SortMode mode);
+        SortMode get_sort_mode() const;
+        void clear();
+        // Each mesh draws with the variant of its material, the specular map flag of features is overridden.
+        void submit(ShaderVariants &shader, ShaderFeatures features, const Model &model, const glm::mat4 &transform, float depth,
+                    glm::vec3 color = glm::vec3(1.0f), unsigned int lod = 0);
+        // One draw per mesh and detail level holding instances.
+        void submit_instanced(ShaderVariants &shader, ShaderFeatures features, const Model &model, float depth);
+        void flush();
+
+        const RenderStats &get_stats() const;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "shadow_map.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include "../shader/texture_units.h"
+#include "../profile/counters.h"
+
+ShadowMap::ShadowMap()
+{
+    create_target(STATIC, SHADOW_MAP_SIZE);
+    create_target(DYNAMIC, SHADOW_OVERLAY_SIZE);
+}
+
+ShadowMap::~ShadowMap()
+{
+    for (Target *target : {&STATIC, &DYNAMIC}) {
+        glDeleteFramebuffers(1, &target->framebuffer);
+        glDeleteTextures(1, &target->texture);
+    }
+}
+
+void ShadowMap::create_target(Target &target, GLsizei size)
+{
+    target.size = size;
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    // Linear filtering on a comparison sampler gives 2x2 PCF for free.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    // Outside the map nothing is in shadow.
+    float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, target.texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Shadow map of %dx%d is incomplete.\n", size, size);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowMap::update(glm::vec3 direction, const Bounds &bounds)
+{
+    direction = glm::normalize(direction);
+    if (STATIC_VALID && direction == DIRECTION && bounds.min == BOUNDS_MIN && bounds.max == BOUNDS_MAX) {
+        return;
+    }
+
+    DIRECTION = direction;
+    BOUNDS_MIN = bounds.min;
+    BOUNDS_MAX = bounds.max;
+    STATIC_VALID = false;
+
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 view = glm::lookAt(center - direction, center, up);
+
+    // Tightest light aligned box around the corners of the bounds.
+    glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point(
+            corner & 1 ? bounds.max.x : bounds.min.x,
+            corner & 2 ? bounds.max.y : bounds.min.y,
+            corner & 4 ? bounds.max.z : bounds.min.z
+        );
+        glm::vec3 lightPoint = glm::vec3(view * glm::vec4(point, 1.0f));
+        low = glm::min(low, lightPoint);
+        high = glm::max(high, lightPoint);
+    }
+
+    // The light looks down -z, the nearest corner has the largest z.
+    glm::mat4 projection = glm::ortho(low.x, high.x, low.y, high.y, -high.z - SHADOW_CASTER_PADDING, -low.z);
+    BLOCK.lightSpace = projection * view;
+    BLOCK_BUFFER.update(&BLOCK);
+}
+
+void ShadowMap::invalidate()
+{
+    STATIC_VALID = false;
+}
+
+bool ShadowMap::static_valid() const
+{
+    return STATIC_VALID;
+}
+
+const glm::mat4 &ShadowMap::get_light_space() const
+{
+    return BLOCK.lightSpace;
+}
+
+unsigned int ShadowMap::get_static_renders() const
+{
+    return STATIC_RENDERS;
+}
+
+void ShadowMap::begin(const Target &target)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, target.size, target.size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(SHADOW_SLOPE_BIAS, SHADOW_CONSTANT_BIAS);
+}
+
+void ShadowMap::begin_static()
+{
+    begin(STATIC);
+    STATIC_VALID = true;
+    STATIC_RENDERS++;
+}
+
+void ShadowMap::begin_dynamic()
+{
+    begin(DYNAMIC);
+}
+
+void ShadowMap::end(int width, int height)
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+void ShadowMap::bind() const
+{
+    glActiveTexture(GL_TEXTURE0 + SHADOW_STATIC_UNIT);
+    glBindTexture(GL_TEXTURE_2D, STATIC.texture);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_DYNAMIC_UNIT);
+    glBindTexture(GL_TEXTURE_2D, DYNAMIC.texture);
+    glActiveTexture(GL_TEXTURE0);
+    Counters::add(Counter::TEXTURE_BINDS, 2);
+}
@@ -0,0 +1,62 @@
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "../model/bounds.h"
+#include "../shader/uniform_blocks.h"
+#include "../shader/uniform_buffer.h"
+
+#define SHADOW_MAP_SIZE       2048
+#define SHADOW_OVERLAY_SIZE   1024
+// Casters between the light and the fitted bounds still have to land in the map.
+#define SHADOW_CASTER_PADDING 20.0f
+#define SHADOW_SLOPE_BIAS     2.0f
+#define SHADOW_CONSTANT_BIAS  4.0f
+
+// Directional light shadows split in two maps sharing one orthographic light
+// space fitted to the static scene. The static map is only redrawn when the
+// light or the fitted bounds change; moving casters go into a smaller overlay
+// redrawn every frame. Receivers take the minimum of both lookups.
+class ShadowMap
+{
+    private:
+        struct Target {
+            GLuint  framebuffer = 0, texture = 0;
+            GLsizei size = 0;
+        };
+
+        Target        STATIC, DYNAMIC;
+        glm::vec3     DIRECTION{0.0f};
+        glm::vec3     BOUNDS_MIN{0.0f}, BOUNDS_MAX{0.0f};
+        bool          STATIC_VALID = false;
+        unsigned int  STATIC_RENDERS = 0;
+        ShadowBlock   BLOCK{};
+        UniformBuffer BLOCK_BUFFER{SHADOW_BLOCK_BINDING, sizeof(ShadowBlock)};
+
+        static void create_target(Target &target, GLsizei size);
+        static void begin(const Target &target);
+
+    public:
+        ShadowMap();
+        ShadowMap(const ShadowMap&) = delete;
+        ShadowMap& operator=(const ShadowMap&) = delete;
+        ~ShadowMap();
+
+        // Fits the light space to the bounds, dropping the static map when either changed.
+        void update(glm::vec3 direction, const Bounds &bounds);
+        void invalidate();
+        bool static_valid() const;
+        const glm::mat4 &get_light_space() const;
+        unsigned int get_static_renders() const;
+
+        // Bind and clear a map for a depth pass, end() restores the default framebuffer and viewport.
+        void begin_static();
+        void begin_dynamic();
+        void end(int width, int height);
+
+        // Binds both maps to their units for the receivers.
+        void bind() const;
+};
+
+#endif
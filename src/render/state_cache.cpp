@@ -0,0 +1,86 @@
+#include "state_cache.h"
+#include "../profile/counters.h"
+
+// Zero is a valid binding, ~0 never matches a real object name.
+#define UNKNOWN_BINDING ((GLuint)~0u)
+
+void StateCache::invalidate()
+{
+    PROGRAM = UNKNOWN_BINDING;
+    VERTEX_ARRAY = UNKNOWN_BINDING;
+    ACTIVE_UNIT = UNKNOWN_BINDING;
+    for (GLuint &texture : TEXTURES) {
+        texture = UNKNOWN_BINDING;
+    }
+}
+
+void StateCache::reset_counters()
+{
+    CHANGES = 0;
+    AVOIDED = 0;
+}
+
+bool StateCache::use_program(GLuint program)
+{
+    if (PROGRAM == program) {
+        AVOIDED++;
+        return false;
+    }
+
+    PROGRAM = program;
+    glUseProgram(program);
+    Counters::add(Counter::PROGRAM_BINDS);
+    CHANGES++;
+
+    return true;
+}
+
+void StateCache::bind_vertex_array(GLuint vertexArray)
+{
+    if (VERTEX_ARRAY == vertexArray) {
+        AVOIDED++;
+        return;
+    }
+
+    VERTEX_ARRAY = vertexArray;
+    glBindVertexArray(vertexArray);
+    Counters::add(Counter::VERTEX_ARRAY_BINDS);
+    CHANGES++;
+}
+
+void StateCache::bind_texture(GLuint unit, GLuint texture)
+{
+    if (unit >= MAX_TEXTURE_UNITS) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        Counters::add(Counter::TEXTURE_BINDS);
+        ACTIVE_UNIT = unit;
+        CHANGES++;
+        return;
+    }
+
+    if (TEXTURES[unit] == texture) {
+        AVOIDED++;
+        return;
+    }
+
+    if (ACTIVE_UNIT != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        ACTIVE_UNIT = unit;
+    }
+
+    TEXTURES[unit] = texture;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    Counters::add(Counter::TEXTURE_BINDS);
+    CHANGES++;
+}
+
+unsigned int StateCache::get_changes() const
+{
+    return CHANGES;
+}
+
+unsigned int StateCache::get_avoided() const
+{
+    return AVOIDED;
+}
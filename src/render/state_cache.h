@@ -0,0 +1,35 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#define MAX_TEXTURE_UNITS 16
+
+// Shadows the GL binding state so redundant glUseProgram, glBindVertexArray
+// and glBindTexture calls are skipped. Anything binding these objects behind
+// its back has to call invalidate() afterwards.
+class StateCache
+{
+    private:
+        GLuint PROGRAM = 0,
+               VERTEX_ARRAY = 0,
+               ACTIVE_UNIT = 0,
+               TEXTURES[MAX_TEXTURE_UNITS] {};
+
+        unsigned int CHANGES = 0,
+                     AVOIDED = 0;
+
+    public:
+        void invalidate();
+        void reset_counters();
+
+        // Returns true when the program actually changed.
+        bool use_program(GLuint program);
+        void bind_vertex_array(GLuint vertexArray);
+        void bind_texture(GLuint unit, GLuint texture);
+
+        unsigned int get_changes() const;
+        unsigned int get_avoided() const;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "scene.h"
+#include <chrono>
+#include <thread>
+#include <GLFW/glfw3.h>
+
+ShaderHandle Scene::add_shader(const char *vertexPath, const char *fragmentPath)
+{
+    string vertex = vertexPath, fragment = fragmentPath;
+
+    SHADERS.emplace_back();
+    PENDING_SHADERS.push_back({SHADERS.size() - 1, WORKERS.submit([vertex, fragment]() {
+        return Shader::readSource(vertex.c_str(), fragment.c_str());
+    })});
+
+    return SHADERS.size() - 1;
+}
+
+ModelHandle Scene::add_model(const char *path, VertexFormat format)
+{
+    string model = path;
+
+    MODELS.emplace_back();
+    PENDING_MODELS.push_back({MODELS.size() - 1, format, WORKERS.submit([model]() {
+        return Model::read(model);
+    })});
+
+    return MODELS.size() - 1;
+}
+
+template<typename Pending>
+static bool ready(const Pending &pending)
+{
+    return pending.source.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void Scene::finish_loading()
+{
+    double start = glfwGetTime();
+    size_t shaderCount = PENDING_SHADERS.size(),
+           modelCount = PENDING_MODELS.size();
+
+    while (!PENDING_SHADERS.empty() || !PENDING_MODELS.empty()) {
+        bool created = false;
+
+        for (size_t i = 0; i < PENDING_SHADERS.size();) {
+            if (!ready(PENDING_SHADERS[i])) {
+                i++;
+                continue;
+            }
+
+            SHADERS[PENDING_SHADERS[i].handle].reset(new ShaderVariants(PENDING_SHADERS[i].source.get()));
+            PENDING_SHADERS.erase(PENDING_SHADERS.begin() + i);
+            created = true;
+        }
+
+        for (size_t i = 0; i < PENDING_MODELS.size();) {
+            if (!ready(PENDING_MODELS[i])) {
+                i++;
+                continue;
+            }
+
+            MODELS[PENDING_MODELS[i].handle].reset(new Model(PENDING_MODELS[i].source.get(), ASSETS, PENDING_MODELS[i].format));
+            PENDING_MODELS.erase(PENDING_MODELS.begin() + i);
+            created = true;
+        }
+
+        if (!created) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    fprintf(stdout, "Loaded %zu shaders and %zu models in %.1f ms on %zu workers.\n",
+            shaderCount, modelCount, (glfwGetTime() - start) * 1000.0, WORKERS.get_worker_count());
+}
+
+void Scene::add_light(Light *light)
+{
+    LIGHTS.emplace_back(light);
+
+    if (light->get_type() == LightType::POINT) {
+        LIGHT_FEATURES.clusteredLights = true;
+        // Warned once, a large light set would otherwise print a line per extra light.
+        if (++POINT_LIGHT_COUNT == MAX_CLUSTERED_LIGHTS + 1) {
+            fprintf(stderr, "Scene has more than %d point lights, only the first %d are clustered.\n", MAX_CLUSTERED_LIGHTS, MAX_CLUSTERED_LIGHTS);
+        }
+        return;
+    }
+
+    if (LIGHT_FEATURES.directionalLights == MAX_LIGHTS) {
+        fprintf(stderr, "Scene has more than %d directional lights, only the first %d are uploaded.\n", MAX_LIGHTS, MAX_LIGHTS);
+        return;
+    }
+    LIGHT_FEATURES.directionalLights++;
+}
+
+void Scene::update_frame(const glm::mat4 &projection, const glm::mat4 &view, glm::vec3 viewPos, float currentTime)
+{
+    FRAME.projection = projection;
+    FRAME.view = view;
+    FRAME.viewPos = viewPos;
+    FRAME.currentTime = currentTime;
+
+    FRAME_BUFFER.update(&FRAME);
+}
+
+static void pack_light(LightBlock &block, Light &light)
+{
+    block.type = static_cast<int>(light.get_type());
+    block.ambient = light.get_ambient();
+    block.diffuse = light.get_diffuse();
+    block.specular = light.get_specular();
+    block.direction = light.get_direction();
+    block.position = light.get_position();
+    block.constant = light.get_constant();
+    block.linear = light.get_linear();
+    block.quadratic = light.get_quadratic();
+}
+
+void Scene::update_lights()
+{
+    LIGHTS_DATA.count = 0;
+    for (const unique_ptr<Light> &light : LIGHTS) {
+        if (light->get_type() != LightType::DIRECTIONAL || LIGHTS_DATA.count == MAX_LIGHTS) {
+            continue;
+        }
+
+        pack_light(LIGHTS_DATA.lights[LIGHTS_DATA.count++], *light);
+    }
+
+    LIGHTS_BUFFER.update(&LIGHTS_DATA);
+    CLUSTERS.update(FRAME.projection, FRAME.view, LIGHTS);
+}
+
+ShaderVariants &Scene::get_shader(ShaderHandle handle) const
+{
+    return *SHADERS[handle];
+}
+
+const LightClusters &Scene::get_light_clusters() const
+{
+    return CLUSTERS;
+}
+
+ShadowMap &Scene::get_shadow_map()
+{
+    return SHADOWS;
+}
+
+const ShaderFeatures &Scene::get_light_features() const
+{
+    return LIGHT_FEATURES;
+}
+
+Model &Scene::get_model(ModelHandle handle) const
+{
+    return *MODELS[handle];
+}
+
+const vector<unique_ptr<Light>> &Scene::get_lights() const
+{
+    return LIGHTS;
+}
+
+TextureLoader &Scene::get_texture_loader()
+{
+    return TEXTURE_LOADER;
+}
+
+AssetRegistry &Scene::get_assets()
+{
+    return ASSETS;
+}
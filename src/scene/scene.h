@@ -0,0 +1,84 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <future>
+#include <memory>
+#include <vector>
+#include "../shader/shader.h"
+#include "../shader/shader_variants.h"
+#include "../shader/uniform_blocks.h"
+#include "../shader/uniform_buffer.h"
+#include "../model/model.h"
+#include "../model/texture_loader.h"
+#include "../model/asset_registry.h"
+#include "../util/thread_pool.h"
+#include "../light/light.h"
+#include "../render/light_clusters.h"
+#include "../render/shadow_map.h"
+
+using std::vector;
+using std::unique_ptr;
+
+typedef size_t ShaderHandle;
+typedef size_t ModelHandle;
+
+class Scene
+{
+    private:
+        struct PendingShader {
+            ShaderHandle              handle;
+            std::future<ShaderSource> source;
+        };
+        struct PendingModel {
+            ModelHandle              handle;
+            VertexFormat             format;
+            std::future<ModelSource> source;
+        };
+
+        ThreadPool                 WORKERS;
+        TextureLoader              TEXTURE_LOADER{WORKERS};
+        AssetRegistry              ASSETS{TEXTURE_LOADER};
+        vector<unique_ptr<ShaderVariants>> SHADERS;
+        vector<unique_ptr<Model>>          MODELS;
+        vector<unique_ptr<Light>>          LIGHTS;
+        vector<PendingShader>              PENDING_SHADERS;
+        vector<PendingModel>               PENDING_MODELS;
+        ShaderFeatures                     LIGHT_FEATURES{};
+        size_t                             POINT_LIGHT_COUNT = 0;
+
+        FrameBlock    FRAME{};
+        LightsBlock   LIGHTS_DATA{};
+        UniformBuffer FRAME_BUFFER{FRAME_BLOCK_BINDING, sizeof(FrameBlock)};
+        UniformBuffer LIGHTS_BUFFER{LIGHTS_BLOCK_BINDING, sizeof(LightsBlock)};
+        LightClusters CLUSTERS;
+        ShadowMap     SHADOWS;
+
+    public:
+        Scene() = default;
+        Scene(const Scene&) = delete;
+        Scene& operator=(const Scene&) = delete;
+
+        // Reads and imports on the worker pool, handles resolve once finish_loading() returns.
+        ShaderHandle add_shader(const char *vertexPath, const char *fragmentPath);
+        ModelHandle add_model(const char *path, VertexFormat format = VertexFormat::FLOAT);
+        // Creates the GL objects on this thread in whatever order the workers finish.
+        void finish_loading();
+        void add_light(Light *light);
+
+        void update_frame(const glm::mat4 &projection, const glm::mat4 &view, glm::vec3 viewPos, float currentTime);
+        // Uploads the directional lights and bins the point lights into clusters for the camera of update_frame().
+        void update_lights();
+
+        ShaderVariants &get_shader(ShaderHandle handle) const;
+        // Lighting of the added lights, the specular map flag is left to the caller.
+        const ShaderFeatures &get_light_features() const;
+        const LightClusters &get_light_clusters() const;
+        // Shadows of the first directional light, drawn by the caller.
+        ShadowMap &get_shadow_map();
+        Model &get_model(ModelHandle handle) const;
+        TextureLoader &get_texture_loader();
+        AssetRegistry &get_assets();
+        const vector<unique_ptr<Light>> &get_lights() const;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#version 330 core
+
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 0
+#endif
+#ifndef SHADOWS
+#define SHADOWS 0
+#endif
+
+struct Light {
+    vec3 direction;
+    int type;
+
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;
+    float quadratic;
+
+    vec3 position;
+};
+
+layout (std140) uniform Lights {
+    Light lights[4];
+    int lightsCount;
+};
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
+
+#if SHADOWS
+layout (std140) uniform Shadow {
+    mat4 lightSpace;
+};
+
+uniform sampler2DShadow shadowStatic;
+uniform sampler2DShadow shadowDynamic;
+#endif
+
+out vec4 FragColor;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0) {
+        discard;
+    }
+
+    vec4 ndc = vec4(gl_FragCoord.xy / vec2(textureSize(gDepth, 0)), depth, 1.0) * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * ndc;
+    vec3 fragPos = world.xyz / world.w;
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 normal = normalize(texelFetch(gNormal, pixel, 0).xyz * 2.0 - 1.0);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    vec3 result = vec3(0.0);
+
+    // Only the first directional light casts shadows.
+    float visibility = 1.0;
+#if SHADOWS
+    vec3 shadowCoords = (lightSpace * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+    visibility = min(texture(shadowStatic, shadowCoords), texture(shadowDynamic, shadowCoords));
+#endif
+
+#if NUM_DIR_LIGHTS > 0
+    for (int i = 0; i < NUM_DIR_LIGHTS; i++) {
+        float lit = i == 0 ? visibility : 1.0;
+        vec3 lightDir = normalize(-lights[i].direction);
+        float diff = max(dot(normal, lightDir), 0.0);
+        vec3 reflectDir = reflect(-lightDir, normal);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), 33.0f);
+
+        result += lights[i].ambient * albedoSpecular.rgb
+                + lights[i].diffuse * diff * albedoSpecular.rgb * lit
+                + lights[i].specular * spec * albedoSpecular.a * lit;
+    }
+#endif
+
+    FragColor = vec4(result, 1.0);
+}
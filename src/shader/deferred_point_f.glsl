@@ -0,0 +1,53 @@
+#version 330 core
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
+
+flat in vec4 PositionRange;
+flat in vec4 AmbientConstant;
+flat in vec4 DiffuseLinear;
+flat in vec4 SpecularQuadratic;
+
+out vec4 FragColor;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+
+    vec4 ndc = vec4(gl_FragCoord.xy / vec2(textureSize(gDepth, 0)), depth, 1.0) * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * ndc;
+    vec3 fragPos = world.xyz / world.w;
+
+    // The volume only rejects surfaces behind it, the ones in front are rejected here.
+    float distance = length(PositionRange.xyz - fragPos);
+    if (depth == 1.0 || distance > PositionRange.w) {
+        discard;
+    }
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+    vec3 normal = normalize(texelFetch(gNormal, pixel, 0).xyz * 2.0 - 1.0);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    vec3 lightDir = normalize(PositionRange.xyz - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 33.0f);
+
+    float attenuation = 1.0 / (AmbientConstant.w + DiffuseLinear.w * distance + SpecularQuadratic.w * (distance * distance));
+
+    vec3 result = AmbientConstant.rgb * albedoSpecular.rgb
+                + DiffuseLinear.rgb * diff * albedoSpecular.rgb
+                + SpecularQuadratic.rgb * spec * albedoSpecular.a;
+
+    FragColor = vec4(result * attenuation, 1.0);
+}
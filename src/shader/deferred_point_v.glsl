@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// Per light, the texel layout of the clustered light buffer.
+layout (location = 1) in vec4 aPositionRange;
+layout (location = 2) in vec4 aAmbientConstant;
+layout (location = 3) in vec4 aDiffuseLinear;
+layout (location = 4) in vec4 aSpecularQuadratic;
+
+// Lights without falloff get a volume that still fits a float depth range.
+#define MAX_VOLUME_RADIUS 1000.0
+
+flat out vec4 PositionRange;
+flat out vec4 AmbientConstant;
+flat out vec4 DiffuseLinear;
+flat out vec4 SpecularQuadratic;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
+
+void main()
+{
+    PositionRange = aPositionRange;
+    AmbientConstant = aAmbientConstant;
+    DiffuseLinear = aDiffuseLinear;
+    SpecularQuadratic = aSpecularQuadratic;
+
+    vec3 position = aPositionRange.xyz + aPos * min(aPositionRange.w, MAX_VOLUME_RADIUS);
+    gl_Position = projection * view * vec4(position, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aModel;
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (std140) uniform Shadow {
+    mat4 lightSpace;
+};
+
+void main()
+{
+    vec3 position = positionOffset + aPos * positionScale;
+
+    gl_Position = lightSpace * aModel * vec4(position, 1.0);
+}
@@ -1,10 +1,38 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 lightSpaceMatrix;
+// Without SHADOWS this is the camera depth pre-pass, with it the shadow map pass.
+#ifndef SHADOWS
+#define SHADOWS 0
+#endif
+
+// The colour pass tests with GL_EQUAL, positions must match model_vertex.glsl bit for bit.
+invariant gl_Position;
+
 uniform mat4 model;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+#if SHADOWS
+layout (std140) uniform Shadow {
+    mat4 lightSpace;
+};
+#else
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
+#endif
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    vec3 position = positionOffset + aPos * positionScale;
+
+#if SHADOWS
+    gl_Position = lightSpace * model * vec4(position, 1.0);
+#else
+    gl_Position = projection * view * model * vec4(position, 1.0);
+#endif
 }
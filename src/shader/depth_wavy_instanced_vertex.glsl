@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aModel;
+
+// Depth pre-pass of wavy_instanced_vertex.glsl, the sway has to match it exactly.
+invariant gl_Position;
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
+
+void main()
+{
+    vec3 position = positionOffset + aPos * positionScale;
+
+    vec3 wavy_pos;
+    if (position.y > 2) {
+        wavy_pos = vec3(
+        position.x + (sin(currentTime + position.y - 2)) / 10,
+        position.y,
+        position.z
+        );
+    } else {
+        wavy_pos = position;
+    }
+    gl_Position = projection * view * aModel * vec4(wavy_pos, 1.0);
+}
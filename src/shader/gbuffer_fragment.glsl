@@ -0,0 +1,30 @@
+#version 330 core
+
+#ifndef HAS_SPECULAR_MAP
+#define HAS_SPECULAR_MAP 0
+#endif
+
+// Albedo with the specular intensity in alpha, and the world space normal.
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormal;
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+#if HAS_SPECULAR_MAP
+uniform sampler2D texture_specular1;
+#endif
+
+void main()
+{
+    gAlbedoSpecular.rgb = vec3(texture(texture_diffuse1, TexCoords));
+#if HAS_SPECULAR_MAP
+    gAlbedoSpecular.a = texture(texture_specular1, TexCoords).r;
+#else
+    gAlbedoSpecular.a = 0.0;
+#endif
+
+    gNormal = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
@@ -1,12 +1,22 @@
 #version 330 core
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
 
 layout (location = 0) in vec3 vertex;
+invariant gl_Position;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(vertex, 1.0);
+    vec3 position = positionOffset + vertex * positionScale;
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
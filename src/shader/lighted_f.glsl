@@ -7,26 +7,34 @@ struct Material {
 };
 
 struct Light {
-    int type;
     vec3 direction;
+    int type;
 
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
 
     vec3 position;
-    float constant;
-    float linear;
-    float quadratic;
+};
+
+layout (std140) uniform Lights {
+    Light lights[4];
+    int lightsCount;
+};
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
 };
 
 out vec4 FragColor;
 
 uniform Material material;
-uniform vec3 viewPos;
-
-uniform int lightsCount;
-uniform Light lights[3];
 
 in vec3 Normal;
 in vec3 FragPos;
@@ -42,7 +50,7 @@ void main()
 
     vec3 result = vec3(0.0);
 
-    for (int i = 0; i < lights.length(); i++) {
+    for (int i = 0; i < lightsCount; i++) {
         switch (lights[i].type) {
             case 0:
                 result += calc_directional_light(lights[i], normalized, viewDir);
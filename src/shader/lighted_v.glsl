@@ -5,8 +5,16 @@ out vec3 FragPos;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
 
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
@@ -14,8 +22,10 @@ layout (location = 2) in vec2 texCoords;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(vertex, 1.0);
-    FragPos = vec3(model * vec4(vertex, 1.0));
-    Normal = mat3(transpose(inverse(model))) * normal;
+    vec3 position = positionOffset + vertex * positionScale;
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = normalMatrix * normal;
     TexCoords = texCoords;
 }
\ No newline at end of file
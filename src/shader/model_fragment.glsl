@@ -1,19 +1,62 @@
 #version 330 core
 
+// Injected per variant by ShaderVariants. The Lights block holds the directional
+// lights, point lights come from the cluster of the fragment.
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 0
+#endif
+#ifndef CLUSTERED_LIGHTS
+#define CLUSTERED_LIGHTS 0
+#endif
+#ifndef HAS_SPECULAR_MAP
+#define HAS_SPECULAR_MAP 0
+#endif
+#ifndef SHADOWS
+#define SHADOWS 0
+#endif
+
 struct Light {
-    int type;
     vec3 direction;
+    int type;
 
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
 
     vec3 position;
-    float constant;
-    float linear;
-    float quadratic;
 };
 
+layout (std140) uniform Lights {
+    Light lights[4];
+    int lightsCount;
+};
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
+
+#if CLUSTERED_LIGHTS
+layout (std140) uniform Clusters {
+    float clusterNear;
+    float clusterFar;
+    float sliceScale;
+    float sliceBias;
+    uvec4 clusterSize; // tiles x, tiles y, slices, light count
+};
+#endif
+
+#if SHADOWS
+layout (std140) uniform Shadow {
+    mat4 lightSpace;
+};
+#endif
+
 out vec4 FragColor;
 
 in vec3 Normal;
@@ -21,70 +64,147 @@ in vec3 FragPos;
 in vec2 TexCoords;
 
 uniform sampler2D texture_diffuse1;
+#if HAS_SPECULAR_MAP
 uniform sampler2D texture_specular1;
-uniform vec3 viewPos;
-uniform int lightsCount;
-uniform Light lights[4];
+#endif
+
+#if CLUSTERED_LIGHTS
+uniform usamplerBuffer clusterGrid;         // offset and count into clusterLightIndices
+uniform usamplerBuffer clusterLightIndices;
+uniform samplerBuffer  pointLights;         // 4 texels per light
+#endif
+
+#if SHADOWS
+uniform sampler2DShadow shadowStatic;       // cached, redrawn when the light moves
+uniform sampler2DShadow shadowDynamic;      // moving casters, redrawn every frame
+#endif
+
+struct Surface {
+    vec3 normal;
+    vec3 viewDir;
+    vec3 diffuse;
+    vec3 specular;
+};
 
-vec3 calc_directional_light(Light light, vec3 normal, vec3 viewDir);
-vec3 calc_point_light(Light light, vec3 normal, vec3 viewDir, vec3 fragPos);
+vec3 calc_light(Light light, vec3 lightDir, Surface surface, float visibility);
+vec3 calc_directional_light(Light light, Surface surface, float visibility);
+vec3 calc_point_light(Light light, Surface surface, vec3 fragPos);
+#if CLUSTERED_LIGHTS
+int cluster_index(vec3 fragPos);
+Light fetch_point_light(int index);
+#endif
+#if SHADOWS
+float shadow_visibility(vec3 fragPos);
+#endif
 
 void main()
 {
-    vec3 normalized = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    Surface surface;
+    surface.normal = normalize(Normal);
+    surface.viewDir = normalize(viewPos - FragPos);
+    surface.diffuse = vec3(texture(texture_diffuse1, TexCoords));
+#if HAS_SPECULAR_MAP
+    surface.specular = vec3(texture(texture_specular1, TexCoords));
+#else
+    surface.specular = vec3(0.0);
+#endif
 
     vec3 result = vec3(0.0);
 
-    for (int i = 0; i < lights.length(); i++) {
-        switch (lights[i].type) {
-            case 0:
-            result += calc_directional_light(lights[i], normalized, viewDir);
-            break;
-            case 1:
-            result += calc_point_light(lights[i], normalized, viewDir, FragPos);
-            break;
-        }
+#if NUM_DIR_LIGHTS > 0
+    // Only the first directional light casts shadows.
+#if SHADOWS
+    result += calc_directional_light(lights[0], surface, shadow_visibility(FragPos));
+#else
+    result += calc_directional_light(lights[0], surface, 1.0);
+#endif
+    for (int i = 1; i < NUM_DIR_LIGHTS; i++) {
+        result += calc_directional_light(lights[i], surface, 1.0);
+    }
+#endif
+#if CLUSTERED_LIGHTS
+    uvec2 cluster = texelFetch(clusterGrid, cluster_index(FragPos)).xy;
+    for (uint i = 0u; i < cluster.y; i++) {
+        int light = int(texelFetch(clusterLightIndices, int(cluster.x + i)).r);
+        result += calc_point_light(fetch_point_light(light), surface, FragPos);
     }
+#endif
 
     FragColor = vec4(result, 1.0);
 }
 
-vec3 calc_directional_light(Light light, vec3 normal, vec3 viewDir)
+vec3 calc_light(Light light, vec3 lightDir, Surface surface, float visibility)
 {
-    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(surface.normal, lightDir), 0.0);
 
-    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 ambient = light.ambient * surface.diffuse;
+    vec3 diffuse = light.diffuse * diff * surface.diffuse * visibility;
 
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 33.0f);
+#if HAS_SPECULAR_MAP
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(surface.viewDir, reflectDir), 0.0), 33.0f);
 
-    vec3 ambient  = light.ambient  * vec3(texture(texture_diffuse1, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(texture_specular1, TexCoords));
+    return (ambient + diffuse + light.specular * spec * surface.specular * visibility);
+#else
+    return (ambient + diffuse);
+#endif
+}
 
-    return (ambient + diffuse + specular);
+vec3 calc_directional_light(Light light, Surface surface, float visibility)
+{
+    return calc_light(light, normalize(-light.direction), surface, visibility);
 }
 
-vec3 calc_point_light(Light light, vec3 normal, vec3 viewDir, vec3 fragPos)
+vec3 calc_point_light(Light light, Surface surface, vec3 fragPos)
 {
     vec3 lightDir = normalize(light.position - fragPos);
 
-    float diff = max(dot(normal, lightDir), 0.0);
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 33.0f);
+    return calc_light(light, lightDir, surface, 1.0) * attenuation;
+}
 
-    vec3 ambient  = light.ambient  * vec3(texture(texture_diffuse1, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(texture_specular1, TexCoords));
+#if CLUSTERED_LIGHTS
+int cluster_index(vec3 fragPos)
+{
+    vec4 viewPosition = view * vec4(fragPos, 1.0);
+    vec4 clip = projection * viewPosition;
 
-    float distance    = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    ivec2 tile = ivec2(clamp(clip.xy / clip.w * 0.5 + 0.5, 0.0, 0.9999) * vec2(clusterSize.xy));
+    float slice = log(max(-viewPosition.z, clusterNear)) * sliceScale + sliceBias;
+    int depthSlice = clamp(int(slice), 0, int(clusterSize.z) - 1);
+
+    return (depthSlice * int(clusterSize.y) + tile.y) * int(clusterSize.x) + tile.x;
+}
 
-    ambient  *= attenuation;
-    diffuse  *= attenuation;
-    specular *= attenuation;
+Light fetch_point_light(int index)
+{
+    vec4 position = texelFetch(pointLights, index * 4);
+    vec4 ambient  = texelFetch(pointLights, index * 4 + 1);
+    vec4 diffuse  = texelFetch(pointLights, index * 4 + 2);
+    vec4 specular = texelFetch(pointLights, index * 4 + 3);
+
+    Light light;
+    light.direction = vec3(0.0);
+    light.type      = 1;
+    light.position  = position.xyz;
+    light.ambient   = ambient.rgb;
+    light.constant  = ambient.w;
+    light.diffuse   = diffuse.rgb;
+    light.linear    = diffuse.w;
+    light.specular  = specular.rgb;
+    light.quadratic = specular.w;
+
+    return light;
+}
+#endif
+
+#if SHADOWS
+float shadow_visibility(vec3 fragPos)
+{
+    vec3 coords = (lightSpace * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
 
-    return (ambient + diffuse + specular);
+    return min(texture(shadowStatic, coords), texture(shadowDynamic, coords));
 }
+#endif
@@ -6,15 +6,26 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
+invariant gl_Position;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 position = positionOffset + aPos * positionScale;
+
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = normalMatrix * aNormal;
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "program_cache.h"
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <vector>
+#include <sys/stat.h>
+#include "../util/hash.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+using std::vector;
+
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+static GetProgramBinaryProc  get_program_binary = nullptr;
+static ProgramBinaryProc     program_binary = nullptr;
+static ProgramParameteriProc program_parameteri = nullptr;
+
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+bool              ProgramCache::SUPPORTED = false;
+uint64_t          ProgramCache::DRIVER_HASH = FNV_OFFSET_BASIS;
+ProgramCacheStats ProgramCache::STATS {};
+
+static uint64_t hash_gl_string(GLenum name, uint64_t seed)
+{
+    const GLubyte *value = glGetString(name);
+    if (!value) {
+        return seed;
+    }
+
+    return hash_string((const char *)value, seed);
+}
+
+void ProgramCache::init()
+{
+    DRIVER_HASH = hash_gl_string(GL_VERSION, hash_gl_string(GL_RENDERER, hash_gl_string(GL_VENDOR, FNV_OFFSET_BASIS)));
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool core = major > 4 || (major == 4 && minor >= 1);
+
+    if (core || glfwExtensionSupported("GL_ARB_get_program_binary")) {
+        get_program_binary = (GetProgramBinaryProc) glfwGetProcAddress("glGetProgramBinary");
+        program_binary = (ProgramBinaryProc) glfwGetProcAddress("glProgramBinary");
+        program_parameteri = (ProgramParameteriProc) glfwGetProcAddress("glProgramParameteri");
+    }
+
+    GLint formats = 0;
+    if (get_program_binary && program_binary && program_parameteri) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+
+    SUPPORTED = formats > 0;
+    if (!SUPPORTED) {
+        fprintf(stdout, "Program binaries are not supported by the driver, shaders are compiled on every start.\n");
+        return;
+    }
+
+#ifdef _WIN32
+    _mkdir(PROGRAM_CACHE_DIRECTORY);
+#else
+    mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+#endif
+}
+
+uint64_t ProgramCache::key(const string &vertex, const string &fragment)
+{
+    // The length keeps "ab" + "c" and "a" + "bc" apart.
+    uint64_t vertexLength = vertex.size();
+    uint64_t hash = hash_bytes(&vertexLength, sizeof(vertexLength), DRIVER_HASH);
+    hash = hash_string(vertex, hash);
+
+    return hash_string(fragment, hash);
+}
+
+string ProgramCache::path_for(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+
+    return string(PROGRAM_CACHE_DIRECTORY) + "/" + name;
+}
+
+GLuint ProgramCache::load(uint64_t key)
+{
+    if (!SUPPORTED) {
+        STATS.misses++;
+        return 0;
+    }
+
+    FILE *file = fopen(path_for(key).c_str(), "rb");
+    if (!file) {
+        STATS.misses++;
+        return 0;
+    }
+
+    ProgramCacheHeader header {};
+    vector<unsigned char> binary;
+    bool read = fread(&header, sizeof(header), 1, file) == 1
+             && header.magic == PROGRAM_CACHE_MAGIC
+             && header.version == PROGRAM_CACHE_VERSION
+             && header.key == key;
+    if (read) {
+        binary.resize(header.length);
+        read = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    if (!read) {
+        STATS.misses++;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    program_binary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // Driver updates invalidate binaries without changing the version string on some platforms.
+        glDeleteProgram(program);
+        STATS.misses++;
+        STATS.rejected++;
+        return 0;
+    }
+
+    STATS.hits++;
+
+    return program;
+}
+
+void ProgramCache::prepare(GLuint program)
+{
+    if (SUPPORTED) {
+        program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+bool ProgramCache::store(uint64_t key, GLuint program)
+{
+    GLint linked = GL_FALSE, length = 0;
+    if (SUPPORTED) {
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    }
+    if (!linked || length <= 0) {
+        return false;
+    }
+
+    ProgramCacheHeader header {PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, 0, 0};
+    vector<unsigned char> binary((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    get_program_binary(program, length, &written, &format, binary.data());
+    header.format = format;
+    header.length = (uint32_t)written;
+
+    string path = path_for(key);
+    string temporaryPath = path + ".tmp";
+
+    FILE *file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool saved = fwrite(&header, sizeof(header), 1, file) == 1
+              && fwrite(binary.data(), 1, (size_t)written, file) == (size_t)written;
+    saved = fclose(file) == 0 && saved;
+
+    std::remove(path.c_str());
+    if (!saved || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    STATS.stored++;
+
+    return true;
+}
+
+const ProgramCacheStats &ProgramCache::get_stats()
+{
+    return STATS;
+}
+
+void ProgramCache::print_report()
+{
+    fprintf(stdout, "Program cache: %u hits, %u misses (%u rejected by the driver), %u binaries stored.\n",
+            STATS.hits, STATS.misses, STATS.rejected, STATS.stored);
+}
@@ -0,0 +1,46 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+#define PROGRAM_CACHE_DIRECTORY "shadercache"
+#define PROGRAM_CACHE_MAGIC     0x50535046u // "FPSP"
+#define PROGRAM_CACHE_VERSION   1
+
+struct ProgramCacheStats {
+    unsigned int hits, misses, rejected, stored;
+};
+
+// Linked program binaries on disk, keyed by the sources as compiled plus the
+// GL vendor, renderer and version. Needs GL 4.1 or ARB_get_program_binary,
+// whose entry points are not in the 3.3 loader and are fetched by init().
+// Without them every lookup misses and nothing is written.
+class ProgramCache
+{
+    private:
+        static bool              SUPPORTED;
+        static uint64_t          DRIVER_HASH;
+        static ProgramCacheStats STATS;
+
+        static string path_for(uint64_t key);
+
+    public:
+        // Needs the context current.
+        static void init();
+        static uint64_t key(const string &vertex, const string &fragment);
+
+        // Returns a linked program or 0 when the binary is missing or the driver rejects it.
+        static GLuint load(uint64_t key);
+        // Has to be called before glLinkProgram for the driver to keep the binary around.
+        static void prepare(GLuint program);
+        static bool store(uint64_t key, GLuint program);
+
+        static const ProgramCacheStats &get_stats();
+        static void print_report();
+};
+
+#endif
@@ -1,10 +1,16 @@
 #include "shader.h"
+#include "../profile/counters.h"
+#include "program_cache.h"
 
 unsigned int ID;
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath)
+Shader::Shader(const char *vertexPath, const char *fragmentPath) : Shader(readSource(vertexPath, fragmentPath))
 {
-    string vertexCode, fragmentCode;
+}
+
+ShaderSource Shader::readSource(const char *vertexPath, const char *fragmentPath)
+{
+    ShaderSource source;
 
     try {
         ifstream vShaderFile, fShaderFile;
@@ -20,16 +26,40 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
         vShaderFile.close();
         fShaderFile.close();
 
-        vertexCode   = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        source.vertex   = vShaderStream.str();
+        source.fragment = fShaderStream.str();
     } catch (ifstream::failure& error) {
         fprintf(stderr, "Failed to initialize shader. %s", error.what());
     }
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    return source;
+}
 
-    unsigned int vertexShader, fragmentShader;
+string Shader::withDefines(const string &source, const string &defines)
+{
+    if (defines.empty()) {
+        return source;
+    }
+
+    // #version has to stay the first directive, anything else may follow it.
+    size_t insert = 0, version = source.find("#version");
+    if (version != string::npos) {
+        size_t newline = source.find('\n', version);
+        if (newline == string::npos) {
+            return source + "\n" + defines;
+        }
+        insert = newline + 1;
+    }
+
+    return source.substr(0, insert) + defines + source.substr(insert);
+}
+
+GLuint Shader::compile(const string &vertex, const string &fragment)
+{
+    const char* vShaderCode = vertex.c_str();
+    const char* fShaderCode = fragment.c_str();
+
+    unsigned int vertexShader, fragmentShader, program;
 
     vertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexShader, 1, &vShaderCode, nullptr);
@@ -41,14 +71,43 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
     glCompileShader(fragmentShader);
     Shader::checkCompileErrors(fragmentShader, "FRAGMENT");
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vertexShader);
-    glAttachShader(ID, fragmentShader);
-    glLinkProgram(ID);
-    Shader::checkCompileErrors(ID, "PROGRAM");
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    ProgramCache::prepare(program);
+    glLinkProgram(program);
+    Shader::checkCompileErrors(program, "PROGRAM");
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+
+    return program;
+}
+
+Shader::Shader(const ShaderSource &source, const string &defines)
+{
+    string vertex = withDefines(source.vertex, defines);
+    string fragment = withDefines(source.fragment, defines);
+
+    uint64_t cacheKey = ProgramCache::key(vertex, fragment);
+    ID = ProgramCache::load(cacheKey);
+    if (!ID) {
+        ID = compile(vertex, fragment);
+        ProgramCache::store(cacheKey, ID);
+    }
+
+    loadUniforms();
+    OBJECT_UNIFORMS.model = handle("model");
+    OBJECT_UNIFORMS.normalMatrix = handle("normalMatrix");
+    OBJECT_UNIFORMS.color = handle("color");
+    OBJECT_UNIFORMS.positionOffset = handle("positionOffset");
+    OBJECT_UNIFORMS.positionScale = handle("positionScale");
+    OBJECT_UNIFORMS.inverseViewProjection = handle("inverseViewProjection");
+
+    bindUniformBlock("Frame", FRAME_BLOCK_BINDING);
+    bindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+    bindUniformBlock("Clusters", CLUSTERS_BLOCK_BINDING);
+    bindUniformBlock("Shadow", SHADOW_BLOCK_BINDING);
 }
 
 void Shader::use() const
@@ -56,6 +115,21 @@ void Shader::use() const
     glUseProgram(ID);
 }
 
+GLuint Shader::id() const
+{
+    return ID;
+}
+
+const ObjectUniforms &Shader::objectUniforms() const
+{
+    return OBJECT_UNIFORMS;
+}
+
+bool Shader::samplesMaterial() const
+{
+    return MATERIAL_SAMPLERS;
+}
+
 void Shader::checkCompileErrors(unsigned int shader, const string& type)
 {
     int success;
@@ -78,8 +152,75 @@ void Shader::checkCompileErrors(unsigned int shader, const string& type)
     }
 }
 
+void Shader::loadUniforms()
+{
+    int count, maxLength;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    // Sampler units are fixed per program, assigning them needs the program bound.
+    glUseProgram(ID);
+
+    string name(maxLength, '\0');
+    for (int i = 0; i < count; i++) {
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+
+        string uniformName = name.substr(0, length);
+        GLint location = glGetUniformLocation(ID, uniformName.c_str());
+        if (location < 0) {
+            // Members of uniform blocks have no location.
+            continue;
+        }
+
+        UNIFORMS[uniformName] = location;
+
+        bool sampler = type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_SHADOW
+                    || type == GL_SAMPLER_BUFFER || type == GL_UNSIGNED_INT_SAMPLER_BUFFER;
+        int unit = sampler ? texture_unit(uniformName) : -1;
+        if (unit >= 0) {
+            glUniform1i(location, unit);
+            MATERIAL_SAMPLERS = MATERIAL_SAMPLERS || unit < MATERIAL_TEXTURE_UNITS;
+        }
+
+        // Arrays of basic types are reported once as "name[0]", register every element as well.
+        size_t bracket = uniformName.rfind("[0]");
+        if (bracket == string::npos || bracket + 3 != uniformName.size()) {
+            continue;
+        }
+
+        string base = uniformName.substr(0, bracket);
+        UNIFORMS[base] = location;
+        for (int element = 1; element < size; element++) {
+            string elementName = base + "[" + std::to_string(element) + "]";
+            UNIFORMS[elementName] = glGetUniformLocation(ID, elementName.c_str());
+        }
+    }
+}
+
+void Shader::bindUniformBlock(const char *name, GLuint binding) const
+{
+    GLuint index = glGetUniformBlockIndex(ID, name);
+    if (index == GL_INVALID_INDEX) {
+        return;
+    }
+
+    glUniformBlockBinding(ID, index, binding);
+}
+
+UniformHandle Shader::handle(const string& name) const {
+    auto found = UNIFORMS.find(name);
+    if (found == UNIFORMS.end()) {
+        return {};
+    }
+
+    return {found->second};
+}
+
 GLint Shader::uniform(const string& name) const {
-    return glGetUniformLocation(ID, name.c_str());
+    return this->handle(name).location;
 }
 
 GLint Shader::attribute(const string& name) const {
@@ -87,17 +228,46 @@ GLint Shader::attribute(const string& name) const {
 }
 
 void Shader::setUniformMatrix(const string& name, glm::mat4 value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
     glUniformMatrix4fv(this->uniform(name), 1, false, glm::value_ptr(value));
 }
 
 void Shader::setUniformVec3(const string& name, glm::vec3 value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
     glUniform3fv(this->uniform(name), 1, glm::value_ptr(value));
 }
 
 void Shader::setUniformFloat(const string& name, float value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
     glUniform1f(this->uniform(name), value);
 }
 
 void Shader::setUniformInt(const string& name, int value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
     glUniform1i(this->uniform(name), value);
 }
+
+void Shader::setUniformMatrix(UniformHandle handle, glm::mat4 value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
+    glUniformMatrix4fv(handle.location, 1, false, glm::value_ptr(value));
+}
+
+void Shader::setUniformMatrix(UniformHandle handle, const glm::mat3 &value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
+    glUniformMatrix3fv(handle.location, 1, false, glm::value_ptr(value));
+}
+
+void Shader::setUniformVec3(UniformHandle handle, glm::vec3 value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
+    glUniform3fv(handle.location, 1, glm::value_ptr(value));
+}
+
+void Shader::setUniformFloat(UniformHandle handle, float value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
+    glUniform1f(handle.location, value);
+}
+
+void Shader::setUniformInt(UniformHandle handle, int value) const {
+    Counters::add(Counter::UNIFORM_UPLOADS);
+    glUniform1i(handle.location, value);
+}
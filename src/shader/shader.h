@@ -7,28 +7,74 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "uniform_blocks.h"
+#include "texture_units.h"
 
 using std::string;
 using std::ifstream;
 using std::stringstream;
+using std::unordered_map;
+
+struct UniformHandle {
+    GLint location = -1;
+
+    bool valid() const { return location >= 0; }
+};
+
+// Per-object uniforms set by the renderer for every draw.
+struct ObjectUniforms {
+    UniformHandle model, normalMatrix, color;
+    UniformHandle positionOffset, positionScale;
+    // Deferred lighting passes, to rebuild positions from the G-buffer depth.
+    UniformHandle inverseViewProjection;
+};
+
+// Stage sources read off the GL thread, compiled by the Shader constructor.
+struct ShaderSource {
+    string vertex, fragment;
+};
 
 class Shader
 {
     private:
         unsigned int ID;
+        unordered_map<string, GLint> UNIFORMS;
+        ObjectUniforms OBJECT_UNIFORMS;
+        bool MATERIAL_SAMPLERS = false;
+
         static void checkCompileErrors(uint shader, const string& type);
+        static string withDefines(const string &source, const string &defines);
+        static GLuint compile(const string &vertex, const string &fragment);
+        void loadUniforms();
+        void bindUniformBlock(const char *name, GLuint binding) const;
 
     public:
         Shader(const char* vertexPath, const char* fragmentPath);
+        // The defines are inserted after the #version line of both stages.
+        explicit Shader(const ShaderSource &source, const string &defines = "");
+        static ShaderSource readSource(const char* vertexPath, const char* fragmentPath);
+        Shader(const Shader&) = delete;
+        Shader& operator=(const Shader&) = delete;
         void use() const;
+        GLuint id() const;
+        const ObjectUniforms &objectUniforms() const;
+        // False for depth only programs, which draw without binding a material.
+        bool samplesMaterial() const;
+        UniformHandle handle(const string& name) const;
         GLint uniform(const string& name) const;
         GLint attribute(const string& name) const;
         void setUniformMatrix(const string& name, glm::mat4 value) const;
         void setUniformVec3(const string& name, glm::vec3 value) const;
         void setUniformFloat(const string& name, float value) const;
         void setUniformInt(const string& name, int value) const;
+        void setUniformMatrix(UniformHandle handle, glm::mat4 value) const;
+        void setUniformMatrix(UniformHandle handle, const glm::mat3 &value) const;
+        void setUniformVec3(UniformHandle handle, glm::vec3 value) const;
+        void setUniformFloat(UniformHandle handle, float value) const;
+        void setUniformInt(UniformHandle handle, int value) const;
 };
 
 #endif
@@ -0,0 +1,40 @@
+#include "shader_variants.h"
+
+uint32_t ShaderFeatures::key() const
+{
+    return (uint32_t)directionalLights
+         | (uint32_t)clusteredLights << 8
+         | (uint32_t)specularMap << 16
+         | (uint32_t)shadows << 24;
+}
+
+string ShaderFeatures::defines() const
+{
+    return "#define NUM_DIR_LIGHTS " + std::to_string(directionalLights) + "\n"
+         + "#define CLUSTERED_LIGHTS " + (clusteredLights ? "1" : "0") + "\n"
+         + "#define HAS_SPECULAR_MAP " + (specularMap ? "1" : "0") + "\n"
+         + "#define SHADOWS " + (shadows ? "1" : "0") + "\n";
+}
+
+ShaderVariants::ShaderVariants(ShaderSource source) : SOURCE(std::move(source))
+{
+}
+
+const Shader &ShaderVariants::get(const ShaderFeatures &features)
+{
+    uint32_t key = features.key();
+    auto found = VARIANTS.find(key);
+    if (found != VARIANTS.end()) {
+        return *found->second;
+    }
+
+    Shader *shader = new Shader(SOURCE, features.defines());
+    VARIANTS[key].reset(shader);
+
+    return *shader;
+}
+
+size_t ShaderVariants::get_variant_count() const
+{
+    return VARIANTS.size();
+}
@@ -0,0 +1,39 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <cstdint>
+#include <memory>
+#include "shader.h"
+
+using std::unique_ptr;
+
+// Compile time switches of the lit shaders, each combination is a separate program.
+struct ShaderFeatures {
+    uint8_t directionalLights = 0;
+    bool    clusteredLights = false;
+    bool    specularMap = false;
+    bool    shadows = false;
+
+    uint32_t key() const;
+    // The #define lines injected right after the #version directive.
+    string defines() const;
+};
+
+// Lazily compiled permutations of one vertex/fragment pair, keyed by their features.
+class ShaderVariants
+{
+    private:
+        ShaderSource                                SOURCE;
+        unordered_map<uint32_t, unique_ptr<Shader>> VARIANTS;
+
+    public:
+        explicit ShaderVariants(ShaderSource source);
+        ShaderVariants(const ShaderVariants&) = delete;
+        ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+        // Compiles the variant on first use, later lookups only hash the key.
+        const Shader &get(const ShaderFeatures &features);
+        size_t get_variant_count() const;
+};
+
+#endif
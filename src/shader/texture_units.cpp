@@ -0,0 +1,75 @@
+#include "texture_units.h"
+#include <cstdlib>
+
+static const char *TEXTURE_TYPE_NAMES[TEXTURE_SLOT_COUNT] = {
+    "texture_diffuse",
+    "texture_specular",
+    "texture_normal",
+    "texture_height",
+};
+
+static const char *MATERIAL_STRUCT_NAMES[TEXTURE_SLOT_COUNT] = {
+    "material.diffuse",
+    "material.specular",
+    "material.normal",
+    "material.height",
+};
+
+int texture_slot(const string &typeName)
+{
+    for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+        if (typeName == TEXTURE_TYPE_NAMES[slot]) {
+            return slot;
+        }
+    }
+
+    return -1;
+}
+
+int texture_unit(const string &samplerName)
+{
+    if (samplerName == "clusterGrid") {
+        return CLUSTER_GRID_UNIT;
+    }
+    if (samplerName == "clusterLightIndices") {
+        return CLUSTER_INDICES_UNIT;
+    }
+    if (samplerName == "pointLights") {
+        return POINT_LIGHTS_UNIT;
+    }
+    if (samplerName == "gAlbedoSpecular") {
+        return GBUFFER_ALBEDO_UNIT;
+    }
+    if (samplerName == "gNormal") {
+        return GBUFFER_NORMAL_UNIT;
+    }
+    if (samplerName == "gDepth") {
+        return GBUFFER_DEPTH_UNIT;
+    }
+    if (samplerName == "shadowStatic") {
+        return SHADOW_STATIC_UNIT;
+    }
+    if (samplerName == "shadowDynamic") {
+        return SHADOW_DYNAMIC_UNIT;
+    }
+
+    for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+        if (samplerName == MATERIAL_STRUCT_NAMES[slot]) {
+            return slot * TEXTURES_PER_TYPE;
+        }
+
+        string prefix = TEXTURE_TYPE_NAMES[slot];
+        if (samplerName.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+
+        int number = std::atoi(samplerName.c_str() + prefix.size());
+        if (number < 1 || number > TEXTURES_PER_TYPE) {
+            return -1;
+        }
+
+        return slot * TEXTURES_PER_TYPE + number - 1;
+    }
+
+    return -1;
+}
@@ -0,0 +1,47 @@
+#ifndef TEXTURE_UNITS_H
+#define TEXTURE_UNITS_H
+
+#include <string>
+
+using std::string;
+
+// Every material sampler has a fixed texture unit, derived from its type and
+// number: texture_diffuse1 is unit 0, texture_diffuse2 unit 1, texture_specular1 unit 2...
+
+#define TEXTURES_PER_TYPE 2
+
+enum class TextureSlot {
+    DIFFUSE = 0,
+    SPECULAR = 1,
+    NORMAL = 2,
+    HEIGHT = 3,
+};
+
+#define TEXTURE_SLOT_COUNT 4
+#define MATERIAL_TEXTURE_UNITS (TEXTURE_SLOT_COUNT * TEXTURES_PER_TYPE)
+
+// Buffer textures of the clustered point lights, bound once per frame after the material units.
+#define CLUSTER_GRID_UNIT    MATERIAL_TEXTURE_UNITS
+#define CLUSTER_INDICES_UNIT (MATERIAL_TEXTURE_UNITS + 1)
+#define POINT_LIGHTS_UNIT    (MATERIAL_TEXTURE_UNITS + 2)
+
+// G-buffer targets read by the deferred lighting passes.
+#define GBUFFER_ALBEDO_UNIT  (MATERIAL_TEXTURE_UNITS + 3)
+#define GBUFFER_NORMAL_UNIT  (MATERIAL_TEXTURE_UNITS + 4)
+#define GBUFFER_DEPTH_UNIT   (MATERIAL_TEXTURE_UNITS + 5)
+
+// Cached static and per frame dynamic shadow maps of the directional light.
+#define SHADOW_STATIC_UNIT   (MATERIAL_TEXTURE_UNITS + 6)
+#define SHADOW_DYNAMIC_UNIT  (MATERIAL_TEXTURE_UNITS + 7)
+
+// Never sampled, the texture loader binds the textures it streams here so it leaves every
+// unit above, and the StateCache view of them, untouched.
+#define TEXTURE_UPLOAD_UNIT  (MATERIAL_TEXTURE_UNITS + 8)
+
+// Slot for a loader type name such as "texture_diffuse", -1 when unknown.
+int texture_slot(const string &typeName);
+
+// Unit for a sampler uniform such as "texture_specular1", "material.diffuse", "clusterGrid" or "gNormal", -1 when it has no fixed unit.
+int texture_unit(const string &samplerName);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#define FRAME_BLOCK_BINDING 0
+#define LIGHTS_BLOCK_BINDING 1
+#define CLUSTERS_BLOCK_BINDING 2
+#define SHADOW_BLOCK_BINDING 3
+
+#define MAX_LIGHTS 4
+
+// The structs below mirror the std140 blocks declared in the GLSL sources,
+// every vec3 is followed by a scalar so no padding has to be spelled out.
+
+struct FrameBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float     currentTime;
+};
+
+struct LightBlock {
+    glm::vec3 direction;
+    int       type;
+    glm::vec3 ambient;
+    float     constant;
+    glm::vec3 diffuse;
+    float     linear;
+    glm::vec3 specular;
+    float     quadratic;
+    glm::vec3 position;
+    float     padding;
+};
+
+struct LightsBlock {
+    LightBlock lights[MAX_LIGHTS];
+    int        count;
+    int        padding[3];
+};
+
+struct ClusterBlock {
+    float    nearPlane;
+    float    farPlane;
+    float    sliceScale;
+    float    sliceBias;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    uint32_t slices;
+    uint32_t lightCount;
+};
+
+struct ShadowBlock {
+    glm::mat4 lightSpace;
+};
+
+static_assert(sizeof(FrameBlock) == 144, "FrameBlock does not match the std140 Frame block");
+static_assert(sizeof(LightBlock) == 80, "LightBlock does not match the std140 Light struct");
+static_assert(sizeof(LightsBlock) == MAX_LIGHTS * 80 + 16, "LightsBlock does not match the std140 Lights block");
+
+static_assert(sizeof(ClusterBlock) == 32, "ClusterBlock does not match the std140 Clusters block");
+static_assert(sizeof(ShadowBlock) == 64, "ShadowBlock does not match the std140 Shadow block");
+
+#endif
@@ -0,0 +1,24 @@
+#include "uniform_buffer.h"
+#include "../profile/counters.h"
+
+UniformBuffer::UniformBuffer(GLuint binding, GLsizeiptr size)
+{
+    SIZE = size;
+
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, SIZE, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &ID);
+}
+
+void UniformBuffer::update(const void *data) const
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE, data);
+    Counters::add(Counter::BUFFER_BYTES_UPLOADED, (uint64_t)SIZE);
+}
@@ -0,0 +1,21 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+class UniformBuffer
+{
+    private:
+        unsigned int ID{};
+        GLsizeiptr   SIZE;
+
+    public:
+        UniformBuffer(GLuint binding, GLsizeiptr size);
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+        ~UniformBuffer();
+
+        void update(const void *data) const;
+};
+
+#endif
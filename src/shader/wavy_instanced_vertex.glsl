@@ -0,0 +1,41 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in mat3 aNormalMatrix;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+invariant gl_Position;
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
+
+void main()
+{
+    vec3 position = positionOffset + aPos * positionScale;
+
+    vec3 wavy_pos;
+    if (position.y > 2) {
+        wavy_pos = vec3(
+        position.x + (sin(currentTime + position.y - 2)) / 10,
+        position.y,
+        position.z
+        );
+    } else {
+        wavy_pos = position;
+    }
+    FragPos = vec3(aModel * vec4(wavy_pos, 1.0));
+    Normal = aNormalMatrix * aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * aModel * vec4(wavy_pos, 1.0);
+}
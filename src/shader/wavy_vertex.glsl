@@ -7,25 +7,34 @@ out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 
-uniform float currentTime;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float currentTime;
+};
 
 void main()
 {
+    vec3 position = positionOffset + aPos * positionScale;
+
     vec3 wavy_pos;
-    if (aPos.y > 2) {
+    if (position.y > 2) {
         wavy_pos = vec3(
-        aPos.x + (sin(currentTime + aPos.y - 2)) / 10,
-        aPos.y,
-        aPos.z
+        position.x + (sin(currentTime + position.y - 2)) / 10,
+        position.y,
+        position.z
         );
     } else {
-        wavy_pos = aPos;
+        wavy_pos = position;
     }
     FragPos = vec3(model * vec4(wavy_pos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
     TexCoords = aTexCoords;
     gl_Position = projection * view * model * vec4(wavy_pos, 1.0);
 }
\ No newline at end of file
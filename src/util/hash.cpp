@@ -0,0 +1,41 @@
+#include "hash.h"
+#include <cstdio>
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+uint64_t hash_string(const string &value, uint64_t seed)
+{
+    return hash_bytes(value.data(), value.size(), seed);
+}
+
+bool hash_file(const string &path, uint64_t &hash)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    hash = FNV_OFFSET_BASIS;
+
+    unsigned char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        hash = hash_bytes(buffer, read, hash);
+    }
+
+    bool failed = ferror(file) != 0;
+    fclose(file);
+
+    return !failed;
+}
@@ -0,0 +1,20 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME        1099511628211ull
+
+// 64-bit FNV-1a, pass a previous result as seed to hash data in pieces.
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = FNV_OFFSET_BASIS);
+uint64_t hash_string(const string &value, uint64_t seed = FNV_OFFSET_BASIS);
+
+// Hashes the whole file, returns false when it cannot be read.
+bool hash_file(const string &path, uint64_t &hash);
+
+#endif
@@ -0,0 +1,63 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+    if (!workerCount) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    WORKERS.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; i++) {
+        WORKERS.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(MUTEX);
+        STOPPING = true;
+    }
+    WAKE.notify_all();
+
+    for (std::thread &worker : WORKERS) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::get_worker_count() const
+{
+    return WORKERS.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(MUTEX);
+        JOBS.push(std::move(job));
+    }
+    WAKE.notify_one();
+}
+
+void ThreadPool::work()
+{
+    while (true) {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock(MUTEX);
+            WAKE.wait(lock, [this]() { return STOPPING || !JOBS.empty(); });
+
+            // Drain the queue before stopping so no submitted future is left broken.
+            if (JOBS.empty()) {
+                return;
+            }
+
+            job = std::move(JOBS.front());
+            JOBS.pop();
+        }
+
+        job();
+    }
+}
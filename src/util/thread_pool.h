@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+// Fixed set of worker threads pulling jobs from one FIFO queue. Jobs must not touch GL.
+class ThreadPool
+{
+    private:
+        vector<std::thread>               WORKERS;
+        std::queue<std::function<void()>> JOBS;
+        std::mutex                        MUTEX;
+        std::condition_variable           WAKE;
+        bool                              STOPPING = false;
+
+        void work();
+        void enqueue(std::function<void()> job);
+
+    public:
+        // Zero picks one worker per hardware thread.
+        explicit ThreadPool(unsigned int workerCount = 0);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+        size_t get_worker_count() const;
+
+        template<typename Function>
+        auto submit(Function function) -> std::future<decltype(function())>
+        {
+            typedef decltype(function()) Result;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+            std::future<Result> result = task->get_future();
+            enqueue([task]() { (*task)(); });
+
+            return result;
+        }
+};
+
+#endif